@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#include <frt/frt.h>
+#include <frt/log.h>
+#include <frt/pubsub.h>
+
+/*
+Compares the publish cost of the direct path with core-aware delivery on a
+dual-core ESP32. The producer runs on core 0, one consumer per topic runs on
+core 1. With core-aware delivery the producer only pushes into a lock-free
+ring and the relay task on core 1 fills the subscriber queue.
+*/
+
+#define TOPIC_DIRECT "bench_direct"
+#define TOPIC_CORE "bench_core"
+#define BENCH_MESSAGES 10000
+
+static frt::Publisher<frt::msgs::Temperature> *pub_direct;
+static frt::Publisher<frt::msgs::Temperature> *pub_core;
+static volatile uint32_t received_direct = 0;
+static volatile uint32_t received_core = 0;
+
+static void consumer(void *data)
+{
+    const char *topic = static_cast<const char *>(data);
+    volatile uint32_t *counter = strcmp(topic, TOPIC_DIRECT) == 0 ? &received_direct : &received_core;
+
+    // The first receive on the pinned task records core 1 for this subscription
+    frt::Subscriber<frt::msgs::Temperature> *sub = frt::pubsub::subscribe<frt::msgs::Temperature>(topic);
+
+    for (;;)
+    {
+        frt::msgs::Temperature t;
+        if (sub->receive(t))
+            (*counter)++;
+    }
+}
+
+static uint32_t bench(frt::Publisher<frt::msgs::Temperature> *pub)
+{
+    frt::msgs::Temperature t;
+    t.temperature = 21.0f;
+
+    uint32_t start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < BENCH_MESSAGES; i++)
+    {
+        t.timestamp = xTaskGetTickCount();
+        pub->publish(t, 0);
+    }
+
+    return (ESP.getCycleCount() - start) / BENCH_MESSAGES;
+}
+
+static void producer(void *data)
+{
+    FRT_UNUSED(data);
+
+    // Give the consumers time to subscribe
+    vTaskDelay(pdMS_TO_TICKS(100));
+
+    for (;;)
+    {
+        received_direct = 0;
+        received_core = 0;
+
+        uint32_t direct = bench(pub_direct);
+        uint32_t core = bench(pub_core);
+
+        vTaskDelay(pdMS_TO_TICKS(100));
+        FRT_LOG_INFO("direct: %lu cycles/msg (%lu received)\tcore-aware: %lu cycles/msg (%lu received)", (unsigned long)direct, (unsigned long)received_direct, (unsigned long)core, (unsigned long)received_core);
+
+        vTaskDelay(pdMS_TO_TICKS(2000));
+    }
+}
+
+void setup()
+{
+    Serial.begin(115200);
+
+    FRT_LOG_REGISTER_STREAM(&Serial);
+    FRT_LOG_LEVEL_INFO();
+
+    FRT_LOG_INFO("--- FRT Examples: Core Delivery ---");
+
+    pub_direct = frt::pubsub::advertise<frt::msgs::Temperature>(TOPIC_DIRECT);
+    pub_core = frt::pubsub::advertise<frt::msgs::Temperature>(TOPIC_CORE);
+
+    if (!pub_core->enableCoreDelivery())
+        FRT_LOG_WARN("Core-aware delivery is not available on this target");
+
+    xTaskCreatePinnedToCore(consumer, "cons_direct", 2048, (void *)TOPIC_DIRECT, 2, NULL, 1);
+    xTaskCreatePinnedToCore(consumer, "cons_core", 2048, (void *)TOPIC_CORE, 2, NULL, 1);
+    xTaskCreatePinnedToCore(producer, "producer", 4096, NULL, 1, NULL, 0);
+}
+
+void loop()
+{
+    vTaskDelete(NULL);
+}
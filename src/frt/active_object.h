@@ -0,0 +1,124 @@
+#ifndef __FRT_ACTIVE_OBJECT_H__
+#define __FRT_ACTIVE_OBJECT_H__
+
+#include "frt.h"
+#include "task.h"
+#include "queue.h"
+
+#if (__cplusplus >= 201703L) && defined(__has_include)
+#if __has_include(<variant>)
+#include <variant>
+#define FRT_HAS_VARIANT 1
+#endif
+#endif
+
+#ifndef FRT_HAS_VARIANT
+#define FRT_HAS_VARIANT 0
+#endif
+
+#define FRT_ACTIVE_OBJECT_BATCH 8
+
+namespace frt
+{
+    namespace detail
+    {
+        template <typename T>
+        struct IsVariant : std::false_type
+        {
+        };
+
+#if FRT_HAS_VARIANT
+        template <typename... Ts>
+        struct IsVariant<std::variant<Ts...>> : std::true_type
+        {
+        };
+#endif
+    }
+
+    /**
+     *  Task with a built-in mailbox that calls Derived::handle() for every
+     *  posted message. If Msg is a std::variant, handle() is called with the
+     *  active alternative, so Derived provides one overload per alternative.
+     *
+     *  The mailbox is drained in batches of up to FRT_ACTIVE_OBJECT_BATCH
+     *  messages before the task yields. Messages are copied into a FreeRTOS
+     *  queue and therefore have to be trivially copyable.
+     *
+     *      class Heater : public frt::ActiveObject<Heater, std::variant<SetPoint, Tick>>
+     *      {
+     *      public:
+     *          void handle(const SetPoint &sp);
+     *          void handle(const Tick &t);
+     *      };
+     */
+    template <typename Derived, typename Msg, unsigned int N = 10, unsigned int STACK_SIZE_BYTES = 2048>
+    class ActiveObject : public Task<Derived, STACK_SIZE_BYTES>
+    {
+    public:
+        using Task<Derived, STACK_SIZE_BYTES>::post;
+
+        /**
+         *  Post a message to the mailbox.
+         *
+         *  @param msecs How long to wait for space in the mailbox.
+         *  @return true if the message was queued.
+         */
+        bool post(const Msg &msg, unsigned int msecs = 0)
+        {
+            return _mailbox.push(msg, msecs);
+        }
+
+        bool postFromIsr(const Msg &msg)
+        {
+            return _mailbox.push(msg, 0);
+        }
+
+        unsigned int pending() const
+        {
+            return _mailbox.available();
+        }
+
+        bool run() override final
+        {
+            Msg msg;
+
+            if (!_mailbox.pop(msg))
+                return true;
+
+            dispatch(msg);
+
+            for (unsigned int i = 1; i < FRT_ACTIVE_OBJECT_BATCH && _mailbox.tryPop(msg); i++)
+            {
+                dispatch(msg);
+            }
+
+            this->yield();
+
+            return true;
+        }
+
+    private:
+        void dispatch(const Msg &msg)
+        {
+            dispatch(msg, detail::IsVariant<Msg>());
+        }
+
+        void dispatch(const Msg &msg, std::false_type)
+        {
+            static_cast<Derived *>(this)->handle(msg);
+        }
+
+#if FRT_HAS_VARIANT
+        void dispatch(const Msg &msg, std::true_type)
+        {
+            std::visit([this](const auto &alternative)
+                       { static_cast<Derived *>(this)->handle(alternative); },
+                       msg);
+        }
+#endif
+
+        Queue<Msg, N> _mailbox;
+    };
+}
+
+#endif // __FRT_ACTIVE_OBJECT_H__
@@ -0,0 +1,225 @@
+#ifndef __FRT_CALLBACK_TIMER_H__
+#define __FRT_CALLBACK_TIMER_H__
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "frt.h"
+#include "log.h"
+#include "timer.h"
+#include "inline_function.h"
+
+#define FRT_CALLBACK_TIMER_CAPACITY 16
+#define FRT_CALLBACK_TIMER_POOL 8
+
+namespace frt
+{
+    namespace detail
+    {
+        // Pool entry of a timer that is constructed on first use
+        template <typename T>
+        struct TimerSlot
+        {
+            std::atomic<bool> in_use;
+            bool constructed;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+    }
+
+    /**
+     *  Timer that runs a callable instead of a run() override. The callable
+     *  is stored inline in CAPACITY bytes, so neither the timer nor its
+     *  callback allocate.
+     *
+     *      frt::CallbackTimer<> blink("blink", 500, true, [] { digitalToggle(LED_BUILTIN); });
+     *      blink.start();
+     *
+     *  For fire-and-forget work once() and every() take a timer from a
+     *  static pool of FRT_CALLBACK_TIMER_POOL timers per CAPACITY. A one shot
+     *  timer goes back to the pool after its callback returned, a periodic
+     *  one with cancel().
+     *
+     *      frt::CallbackTimer<>::once(50, [this] { _relay.off(); });
+     *      auto *poll = frt::CallbackTimer<>::every(1000, [] { sensors.poll(); });
+     *      poll->cancel();
+     *
+     *  Callbacks run in the timer daemon task and must not block. Called
+     *  from a callback, once(), every() and cancel() do not wait for room in
+     *  the timer command queue, as only the daemon itself could make room.
+     */
+    template <size_t CAPACITY = FRT_CALLBACK_TIMER_CAPACITY>
+    class CallbackTimer final : public Timer
+    {
+    public:
+        template <typename F>
+        CallbackTimer(const char *const name, unsigned int msecs, bool periodic, F &&fn) : Timer(name, ticks(msecs), periodic),
+                                                                                            _fn(std::forward<F>(fn)),
+                                                                                            _in_use(nullptr),
+                                                                                            _periodic(periodic)
+        {
+        }
+
+        template <typename F>
+        CallbackTimer(unsigned int msecs, bool periodic, F &&fn) : Timer(ticks(msecs), periodic),
+                                                                   _fn(std::forward<F>(fn)),
+                                                                   _in_use(nullptr),
+                                                                   _periodic(periodic)
+        {
+        }
+
+        /**
+         *  Run fn once after msecs, on a timer from the pool.
+         *  Not callable from an ISR, as a pool timer is created on first use.
+         *
+         *  @return false if all timers of the pool are in use, or the timer
+         *          could not be started from the daemon task.
+         */
+        template <typename F>
+        static bool once(unsigned int msecs, F &&fn)
+        {
+            return acquire(msecs, false, std::forward<F>(fn)) != nullptr;
+        }
+
+        /**
+         *  Run fn every msecs, on a timer from the pool, until cancel().
+         *  Not callable from an ISR, as a pool timer is created on first use.
+         *
+         *  @return The timer, nullptr if all timers of the pool are in use,
+         *          or the timer could not be started from the daemon task.
+         */
+        template <typename F>
+        static CallbackTimer *every(unsigned int msecs, F &&fn)
+        {
+            return acquire(msecs, true, std::forward<F>(fn));
+        }
+
+        /**
+         *  Stop the timer and return it to the pool. The timer must not be
+         *  used afterwards. For a timer that is not from the pool this is
+         *  the same as stop().
+         *
+         *  @return false if the stop command could not be queued from the
+         *          daemon task. The timer keeps running, try again later.
+         */
+        bool cancel()
+        {
+            const TickType_t timeout = commandTimeout();
+
+            if (!stop(timeout))
+                return false;
+
+            if (_in_use == nullptr)
+                return true;
+
+#if (INCLUDE_xTimerPendFunctionCall == 1)
+            // Queued behind the stop command, so the daemon cannot be running the callback at release
+            if (xTimerPendFunctionCall(releaseFromDaemon, this, 0, timeout) == pdPASS)
+                return true;
+#endif
+            // An expiry handled before the stop command finds the callback already reset
+            release();
+
+            return true;
+        }
+
+    protected:
+        void run() override
+        {
+            if (!_fn)
+                return;
+
+            _fn();
+
+            if (_in_use != nullptr && !_periodic)
+                release();
+        }
+
+    private:
+        typedef detail::TimerSlot<CallbackTimer> Slot;
+
+        static TickType_t ticks(unsigned int msecs)
+        {
+            return max(1U, (unsigned int)pdMS_TO_TICKS(msecs));
+        }
+
+        // The daemon must not wait on its own command queue
+        static TickType_t commandTimeout()
+        {
+#if (INCLUDE_xTimerGetTimerDaemonTaskHandle == 1)
+            if (xTaskGetCurrentTaskHandle() == getTimerDaemonHandle())
+                return 0;
+#endif
+            return portMAX_DELAY;
+        }
+
+        static Slot *pool()
+        {
+            static Slot slots[FRT_CALLBACK_TIMER_POOL];
+            return slots;
+        }
+
+        template <typename F>
+        static CallbackTimer *acquire(unsigned int msecs, bool periodic, F &&fn)
+        {
+            Slot *slots = pool();
+
+            for (size_t i = 0; i < FRT_CALLBACK_TIMER_POOL; i++)
+            {
+                Slot &slot = slots[i];
+                bool expected = false;
+
+                if (!slot.in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    continue;
+
+                CallbackTimer *timer = reinterpret_cast<CallbackTimer *>(&slot.storage);
+
+                if (!slot.constructed)
+                {
+                    new (&slot.storage) CallbackTimer(msecs, periodic, [] {});
+                    slot.constructed = true;
+                }
+
+                timer->_fn.assign(std::forward<F>(fn));
+                timer->_periodic = periodic;
+                timer->_in_use = &slot.in_use;
+                timer->setPeriodic(periodic);
+
+                // Also starts the dormant timer
+                if (!timer->setPeriod(ticks(msecs), commandTimeout()))
+                {
+                    FRT_LOG_WARN("Timer command queue full, callback timer not started");
+                    timer->release();
+
+                    return nullptr;
+                }
+
+                return timer;
+            }
+
+            FRT_LOG_WARN("Callback timer pool of %u timers exhausted", FRT_CALLBACK_TIMER_POOL);
+
+            return nullptr;
+        }
+
+        static void releaseFromDaemon(void *timer, uint32_t)
+        {
+            static_cast<CallbackTimer *>(timer)->release();
+        }
+
+        void release()
+        {
+            std::atomic<bool> *in_use = _in_use;
+
+            _fn.reset();
+            in_use->store(false, std::memory_order_release);
+        }
+
+        InlineFunction<CAPACITY> _fn;
+        std::atomic<bool> *_in_use;
+        bool _periodic;
+    };
+}
+
+#endif // __FRT_CALLBACK_TIMER_H__
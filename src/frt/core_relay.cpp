@@ -0,0 +1,106 @@
+#include "core_relay.h"
+#include "pubsub.h"
+
+using namespace frt;
+
+#if FRT_CORE_DELIVERY
+TaskHandle_t CoreRelay::handles[FRT_NUM_CORES]{};
+IPublisher *CoreRelay::publishers[FRT_CORE_RELAY_MAX_PUBLISHERS]{};
+std::atomic<size_t> CoreRelay::publisherCount{0};
+#if configSUPPORT_STATIC_ALLOCATION > 0
+StackType_t CoreRelay::stacks[FRT_NUM_CORES][FRT_CORE_RELAY_STACK_SIZE / sizeof(StackType_t)];
+StaticTask_t CoreRelay::states[FRT_NUM_CORES];
+#endif
+
+bool CoreRelay::registerPublisher(IPublisher *pub)
+{
+    bool registered = false;
+
+    FRT_CRITICAL_ENTER();
+    size_t count = publisherCount.load(std::memory_order_relaxed);
+    if (count < FRT_CORE_RELAY_MAX_PUBLISHERS)
+    {
+        publishers[count] = pub;
+        // Publish the slot only after it has been written, the relays read without locking
+        publisherCount.store(count + 1, std::memory_order_release);
+        registered = true;
+    }
+    FRT_CRITICAL_EXIT();
+
+    if (registered)
+        start();
+
+    return registered;
+}
+
+void CoreRelay::notify(BaseType_t core)
+{
+    TaskHandle_t handle = handles[core];
+
+    if (handle == nullptr)
+        return;
+
+    if (FRT_IS_ISR())
+    {
+        BaseType_t taskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(handle, &taskWoken);
+        detail::yieldFromIsr(taskWoken);
+    }
+    else
+    {
+        xTaskNotifyGive(handle);
+    }
+}
+
+void CoreRelay::start()
+{
+    static std::atomic<bool> started{false};
+    static const char *names[] = {"frt_relay0", "frt_relay1"};
+    static_assert(FRT_NUM_CORES <= sizeof(names) / sizeof(names[0]), "Add relay names for the additional cores");
+
+    if (started.exchange(true))
+        return;
+
+    for (BaseType_t core = 0; core < FRT_NUM_CORES; core++)
+    {
+#if configSUPPORT_STATIC_ALLOCATION > 0
+        handles[core] = xTaskCreateStaticPinnedToCore(
+            entryPoint,
+            names[core],
+            FRT_CORE_RELAY_STACK_SIZE / sizeof(StackType_t),
+            reinterpret_cast<void *>(static_cast<intptr_t>(core)),
+            FRT_CORE_RELAY_PRIORITY,
+            stacks[core],
+            &states[core],
+            core);
+#else
+        xTaskCreatePinnedToCore(
+            entryPoint,
+            names[core],
+            FRT_CORE_RELAY_STACK_SIZE / sizeof(StackType_t),
+            reinterpret_cast<void *>(static_cast<intptr_t>(core)),
+            FRT_CORE_RELAY_PRIORITY,
+            &handles[core],
+            core);
+#endif
+        assert(handles[core] != nullptr);
+    }
+}
+
+void CoreRelay::entryPoint(void *data)
+{
+    const BaseType_t core = static_cast<BaseType_t>(reinterpret_cast<intptr_t>(data));
+
+    for (;;)
+    {
+        // Drain first: messages may have been queued before this relay was running
+        const size_t count = publisherCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++)
+        {
+            publishers[i]->drainCore(core);
+        }
+
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+#endif
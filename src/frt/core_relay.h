@@ -0,0 +1,101 @@
+#ifndef __FRT_CORE_RELAY_H__
+#define __FRT_CORE_RELAY_H__
+
+#include <atomic>
+
+#include "frt.h"
+
+#define FRT_CORE_RING_SIZE 8
+#define FRT_CORE_RELAY_MAX_PUBLISHERS 16
+#define FRT_CORE_RELAY_STACK_SIZE 2048
+#define FRT_CORE_RELAY_PRIORITY (configMAX_PRIORITIES - 2)
+
+namespace frt
+{
+    namespace detail
+    {
+        /**
+         *  Lock-free single-producer single-consumer ring.
+         *  One slot is kept free to tell a full ring from an empty one.
+         */
+        template <typename T, unsigned int N>
+        class SpscRing final
+        {
+        public:
+            SpscRing() : _head(0), _tail(0) {}
+
+            explicit SpscRing(const SpscRing &other) = delete;
+            SpscRing &operator=(const SpscRing &other) = delete;
+
+            bool push(const T &item)
+            {
+                const unsigned int head = _head.load(std::memory_order_relaxed);
+                const unsigned int next = (head + 1) % N;
+
+                if (next == _tail.load(std::memory_order_acquire))
+                    return false;
+
+                _buf[head] = item;
+                _head.store(next, std::memory_order_release);
+
+                return true;
+            }
+
+            bool pop(T &item)
+            {
+                const unsigned int tail = _tail.load(std::memory_order_relaxed);
+
+                if (tail == _head.load(std::memory_order_acquire))
+                    return false;
+
+                item = _buf[tail];
+                _tail.store((tail + 1) % N, std::memory_order_release);
+
+                return true;
+            }
+
+            bool empty() const
+            {
+                return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+            }
+
+        private:
+            T _buf[N];
+            std::atomic<unsigned int> _head;
+            std::atomic<unsigned int> _tail;
+        };
+    }
+
+#if FRT_CORE_DELIVERY
+    class IPublisher;
+
+    /**
+     *  One relay task pinned to every core. A publisher in core-aware mode
+     *  pushes messages for subscribers on another core into a per-core-pair
+     *  SPSC ring and notifies the relay of the destination core, which then
+     *  drains the rings into the local subscriber queues.
+     */
+    class CoreRelay final
+    {
+    public:
+        CoreRelay() = delete;
+
+        static bool registerPublisher(IPublisher *pub);
+        static void notify(BaseType_t core);
+
+    private:
+        static void start();
+        static void entryPoint(void *data);
+
+        static TaskHandle_t handles[FRT_NUM_CORES];
+        static IPublisher *publishers[FRT_CORE_RELAY_MAX_PUBLISHERS];
+        static std::atomic<size_t> publisherCount;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+        static StackType_t stacks[FRT_NUM_CORES][FRT_CORE_RELAY_STACK_SIZE / sizeof(StackType_t)];
+        static StaticTask_t states[FRT_NUM_CORES];
+#endif
+    };
+#endif
+}
+
+#endif // __FRT_CORE_RELAY_H__
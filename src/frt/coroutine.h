@@ -0,0 +1,582 @@
+#ifndef __FRT_COROUTINE_H__
+#define __FRT_COROUTINE_H__
+
+#include "frt.h"
+#include "task.h"
+#include "queue.h"
+#include "mutex.h"
+#include "event_group.h"
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define FRT_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifndef FRT_HAS_COROUTINES
+#define FRT_HAS_COROUTINES 0
+#endif
+
+#if FRT_HAS_COROUTINES
+
+#include <cstddef>
+#include <exception>
+
+// Number of coroutine frames in the static arena, shared by all schedulers
+#ifndef FRT_CO_ARENA_FRAMES
+#define FRT_CO_ARENA_FRAMES 16
+#endif
+
+// Size of one frame slot in bytes, a coroutine with a larger frame fails to spawn
+#ifndef FRT_CO_FRAME_SIZE
+#define FRT_CO_FRAME_SIZE 256
+#endif
+
+namespace frt
+{
+    namespace detail
+    {
+        /**
+         *  Fixed-size frame pool for coroutines.
+         *  Every frame takes one FRT_CO_FRAME_SIZE slot, so allocation is a
+         *  short scan and never fragments.
+         */
+        class CoArena final
+        {
+        public:
+            static void *allocate(size_t size) noexcept
+            {
+                if (size > FRT_CO_FRAME_SIZE)
+                    return nullptr;
+
+                Storage &s = storage();
+                void *frame = nullptr;
+
+                FRT_CRITICAL_ENTER();
+                for (size_t i = 0; i < FRT_CO_ARENA_FRAMES; i++)
+                {
+                    if (!s.used[i])
+                    {
+                        s.used[i] = true;
+                        s.count++;
+                        frame = s.frames[i];
+                        break;
+                    }
+                }
+                FRT_CRITICAL_EXIT();
+
+                return frame;
+            }
+
+            static void release(void *frame) noexcept
+            {
+                Storage &s = storage();
+                const size_t index = (static_cast<unsigned char *>(frame) - &s.frames[0][0]) / FRT_CO_FRAME_SIZE;
+
+                FRT_CRITICAL_ENTER();
+                s.used[index] = false;
+                s.count--;
+                FRT_CRITICAL_EXIT();
+            }
+
+            // Number of frames currently in use
+            static size_t used() { return storage().count; }
+
+            static constexpr size_t capacity() { return FRT_CO_ARENA_FRAMES; }
+
+        private:
+            struct Storage
+            {
+                alignas(std::max_align_t) unsigned char frames[FRT_CO_ARENA_FRAMES][FRT_CO_FRAME_SIZE];
+                bool used[FRT_CO_ARENA_FRAMES];
+                size_t count;
+            };
+
+            static Storage &storage()
+            {
+                static Storage s;
+                return s;
+            }
+        };
+
+        // Wait condition of a suspended coroutine, evaluated by the scheduler
+        struct CoWait
+        {
+            bool (*poll)(void *ctx); // nullptr if the coroutine is runnable
+            void *ctx;
+            Waker *waker; // Wakes the scheduler when the condition may have changed, nullptr for sleeps
+            TickType_t start;
+            TickType_t ticks; // portMAX_DELAY waits forever
+        };
+    }
+
+    /**
+     *  Return type of a coroutine that can be run by a CoScheduler.
+     *  The frame is taken from the static coroutine arena; if the arena is
+     *  exhausted or the frame is too large, the returned object is empty.
+     *
+     *      frt::Coroutine blink(frt::Semaphore &sem)
+     *      {
+     *          for (;;)
+     *          {
+     *              if (co_await frt::co::wait(sem, 500))
+     *                  toggle();
+     *          }
+     *      }
+     */
+    class Coroutine final
+    {
+    public:
+        struct promise_type
+        {
+            detail::CoWait wait{nullptr, nullptr, nullptr, 0, portMAX_DELAY};
+
+            Coroutine get_return_object() { return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            static Coroutine get_return_object_on_allocation_failure() { return Coroutine(); }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+
+            static void *operator new(size_t size) noexcept { return detail::CoArena::allocate(size); }
+            static void operator delete(void *frame) noexcept { detail::CoArena::release(frame); }
+        };
+
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        Coroutine() : _handle(nullptr) {}
+
+        Coroutine(Coroutine &&other) : _handle(other._handle)
+        {
+            other._handle = nullptr;
+        }
+
+        ~Coroutine()
+        {
+            // Frames that were never handed to a scheduler go back to the arena
+            if (_handle)
+                _handle.destroy();
+        }
+
+        explicit Coroutine(const Coroutine &other) = delete;
+        Coroutine &operator=(const Coroutine &other) = delete;
+
+        explicit operator bool() const
+        {
+            return static_cast<bool>(_handle);
+        }
+
+    private:
+        explicit Coroutine(Handle handle) : _handle(handle) {}
+
+        Handle release()
+        {
+            Handle handle = _handle;
+            _handle = nullptr;
+            return handle;
+        }
+
+        Handle _handle;
+
+        template <unsigned int, unsigned int>
+        friend class CoScheduler;
+    };
+
+    namespace detail
+    {
+        /**
+         *  Base of all awaitables. Derived implements poll(), which tries the
+         *  operation without blocking and returns true on success, and
+         *  waker(), the Waker of the primitive it waits on. The awaitable
+         *  lives in the coroutine frame while it is suspended, so the
+         *  scheduler can poll it in place when it is woken.
+         */
+        template <typename Derived>
+        class CoAwaiter
+        {
+        public:
+            explicit CoAwaiter(unsigned int msecs) : _ticks(msecs == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(msecs)),
+                                                     _done(false)
+            {
+            }
+
+            bool await_ready()
+            {
+                _done = static_cast<Derived *>(this)->poll();
+                return _done;
+            }
+
+            void await_suspend(Coroutine::Handle handle)
+            {
+                CoWait &wait = handle.promise().wait;
+
+                wait.poll = &pollFn;
+                wait.ctx = this;
+                wait.waker = static_cast<Derived *>(this)->waker();
+                wait.start = xTaskGetTickCount();
+                wait.ticks = _ticks;
+
+                // The scheduler polls once more before it blocks, so an event before this is not lost
+                if (wait.waker != nullptr)
+                    wait.waker->set(xTaskGetCurrentTaskHandle());
+            }
+
+            Waker *waker() { return nullptr; }
+
+        protected:
+            TickType_t _ticks;
+            bool _done;
+
+        private:
+            static bool pollFn(void *ctx)
+            {
+                CoAwaiter *self = static_cast<CoAwaiter *>(ctx);
+
+                self->_done = static_cast<Derived *>(self)->poll();
+                return self->_done;
+            }
+        };
+
+        class SleepAwaiter : public CoAwaiter<SleepAwaiter>
+        {
+        public:
+            explicit SleepAwaiter(unsigned int msecs) : CoAwaiter<SleepAwaiter>(msecs) {}
+
+            bool poll() { return false; }
+            void await_resume() {}
+        };
+
+        template <typename Sub>
+        class ReceiveAwaiter : public CoAwaiter<ReceiveAwaiter<Sub>>
+        {
+        public:
+            ReceiveAwaiter(Sub &sub, typename Sub::MessageType &msg, unsigned int msecs) : CoAwaiter<ReceiveAwaiter<Sub>>(msecs),
+                                                                                          _sub(sub),
+                                                                                          _msg(msg)
+            {
+            }
+
+            bool poll() { return _sub.tryReceive(_msg); }
+            Waker *waker() { return &_sub.waker(); }
+            bool await_resume() { return this->_done; }
+
+        private:
+            Sub &_sub;
+            typename Sub::MessageType &_msg;
+        };
+
+        template <typename T, unsigned int QUEUE_SIZE>
+        class PopAwaiter : public CoAwaiter<PopAwaiter<T, QUEUE_SIZE>>
+        {
+        public:
+            PopAwaiter(Queue<T, QUEUE_SIZE> &queue, T &item, unsigned int msecs) : CoAwaiter<PopAwaiter<T, QUEUE_SIZE>>(msecs),
+                                                                                  _queue(queue),
+                                                                                  _item(item)
+            {
+            }
+
+            bool poll() { return _queue.tryPop(_item); }
+            Waker *waker() { return &_queue.waker(); }
+            bool await_resume() { return this->_done; }
+
+        private:
+            Queue<T, QUEUE_SIZE> &_queue;
+            T &_item;
+        };
+
+        class SemaphoreAwaiter : public CoAwaiter<SemaphoreAwaiter>
+        {
+        public:
+            SemaphoreAwaiter(Semaphore &sem, unsigned int msecs) : CoAwaiter<SemaphoreAwaiter>(msecs),
+                                                                   _sem(sem)
+            {
+            }
+
+            bool poll() { return _sem.tryWait(); }
+            Waker *waker() { return &_sem.waker(); }
+            bool await_resume() { return _done; }
+
+        private:
+            Semaphore &_sem;
+        };
+
+        class BitsAwaiter : public CoAwaiter<BitsAwaiter>
+        {
+        public:
+            BitsAwaiter(EventGroup &group, EventBits_t bits, bool clearOnExit, bool waitForAllBits, unsigned int msecs) : CoAwaiter<BitsAwaiter>(msecs),
+                                                                                                                          _group(group),
+                                                                                                                          _bits(bits),
+                                                                                                                          _clear(clearOnExit),
+                                                                                                                          _all(waitForAllBits),
+                                                                                                                          _value(0)
+            {
+            }
+
+            bool poll()
+            {
+                _value = _group.getBits();
+
+                const EventBits_t matched = _value & _bits;
+                if (_all ? matched != _bits : matched == 0)
+                    return false;
+
+                if (_clear)
+                    _group.clearBits(_bits);
+
+                return true;
+            }
+
+            Waker *waker() { return &_group.waker(); }
+
+            // Same semantics as EventGroup::waitBits: the bits before clearing
+            EventBits_t await_resume() { return _value; }
+
+        private:
+            EventGroup &_group;
+            EventBits_t _bits;
+            bool _clear;
+            bool _all;
+            EventBits_t _value;
+        };
+    }
+
+    /**
+     *  Awaitables for use inside a Coroutine. A timeout of portMAX_DELAY
+     *  waits forever; the boolean result is false if the wait timed out.
+     */
+    namespace co
+    {
+        inline detail::SleepAwaiter sleep(unsigned int msecs)
+        {
+            return detail::SleepAwaiter(msecs);
+        }
+
+        // Let the other coroutines of the scheduler run
+        inline detail::SleepAwaiter yield()
+        {
+            return detail::SleepAwaiter(0);
+        }
+
+        template <typename Sub>
+        detail::ReceiveAwaiter<Sub> receive(Sub &sub, typename Sub::MessageType &msg, unsigned int msecs = portMAX_DELAY)
+        {
+            return detail::ReceiveAwaiter<Sub>(sub, msg, msecs);
+        }
+
+        template <typename T, unsigned int QUEUE_SIZE>
+        detail::PopAwaiter<T, QUEUE_SIZE> pop(Queue<T, QUEUE_SIZE> &queue, T &item, unsigned int msecs = portMAX_DELAY)
+        {
+            return detail::PopAwaiter<T, QUEUE_SIZE>(queue, item, msecs);
+        }
+
+        inline detail::SemaphoreAwaiter wait(Semaphore &sem, unsigned int msecs = portMAX_DELAY)
+        {
+            return detail::SemaphoreAwaiter(sem, msecs);
+        }
+
+        inline detail::BitsAwaiter waitBits(EventGroup &group, EventBits_t bits, bool clearOnExit, bool waitForAllBits, unsigned int msecs = portMAX_DELAY)
+        {
+            return detail::BitsAwaiter(group, bits, clearOnExit, waitForAllBits, msecs);
+        }
+    }
+
+    /**
+     *  Task that runs up to MAX_COROUTINES coroutines cooperatively on its own
+     *  stack. Suspended coroutines cost only their frame in the arena.
+     *
+     *  While all coroutines are waiting the task blocks until the next
+     *  timeout. A queue, subscriber, semaphore or event group that a
+     *  coroutine waits on wakes the scheduler when it becomes ready, and the
+     *  scheduler then polls the wait conditions. A primitive wakes only the
+     *  scheduler that waited on it last, so coroutines waiting on the same
+     *  primitive have to run on the same scheduler. Calling post() on the
+     *  scheduler wakes it as well.
+     */
+    template <unsigned int MAX_COROUTINES = 8, unsigned int STACK_SIZE_BYTES = 4096>
+    class CoScheduler final : public Task<CoScheduler<MAX_COROUTINES, STACK_SIZE_BYTES>, STACK_SIZE_BYTES>
+    {
+    public:
+        CoScheduler() : _count(0),
+                        _reserved(0)
+        {
+            for (unsigned int i = 0; i < MAX_COROUTINES; i++)
+            {
+                _slots[i] = nullptr;
+            }
+        }
+
+        ~CoScheduler()
+        {
+            // The wakers were armed with the handle of the scheduler task, which is gone after stop()
+            const TaskHandle_t self = *this->handle();
+
+            // No frame may be destroyed while the task still resumes it
+            this->stop();
+
+            for (unsigned int i = 0; i < MAX_COROUTINES; i++)
+            {
+                if (!_slots[i])
+                    continue;
+
+                detail::Waker *waker = _slots[i].promise().wait.waker;
+                if (waker != nullptr)
+                    waker->clear(self);
+
+                _slots[i].destroy();
+                _slots[i] = nullptr;
+            }
+
+            // Coroutines that were spawned but never adopted
+            void *address;
+            while (_spawned.tryPop(address))
+            {
+                Coroutine::Handle::from_address(address).destroy();
+            }
+        }
+
+        /**
+         *  Hand a coroutine to the scheduler. Can be called from any task,
+         *  before or after the scheduler was started.
+         *
+         *  @return false if the coroutine is empty or the scheduler is full.
+         */
+        bool spawn(Coroutine &&co)
+        {
+            if (!co)
+                return false;
+
+            // Reserve a slot first, the scheduler may still be busy with coroutines that finished
+            unsigned int reserved = _reserved.load(std::memory_order_relaxed);
+            do
+            {
+                if (reserved >= MAX_COROUTINES)
+                    return false;
+            } while (!_reserved.compare_exchange_weak(reserved, reserved + 1, std::memory_order_acq_rel));
+
+            void *address = co._handle.address();
+            if (!_spawned.push(address, 0))
+            {
+                _reserved.fetch_sub(1, std::memory_order_release);
+                return false;
+            }
+
+            co.release();
+
+            if (this->isRunning())
+                this->post();
+
+            return true;
+        }
+
+        // Number of coroutines that are running or waiting
+        unsigned int count() const { return _count; }
+
+        bool run() override final
+        {
+            adoptSpawned();
+
+            const TickType_t now = xTaskGetTickCount();
+            TickType_t sleep = portMAX_DELAY;
+            bool progressed = false;
+
+            for (unsigned int i = 0; i < MAX_COROUTINES; i++)
+            {
+                if (!_slots[i])
+                    continue;
+
+                Coroutine::Handle handle = _slots[i];
+                detail::CoWait &wait = handle.promise().wait;
+
+                if (!isRunnable(wait, now, sleep))
+                    continue;
+
+                wait.poll = nullptr;
+                releaseWaker(i);
+                handle.resume();
+                progressed = true;
+
+                if (handle.done())
+                {
+                    handle.destroy();
+                    _slots[i] = nullptr;
+                    _count--;
+                    _reserved.fetch_sub(1, std::memory_order_release);
+                }
+            }
+
+            if (!progressed)
+                ulTaskNotifyTake(pdTRUE, sleep);
+
+            return true;
+        }
+
+    private:
+        void adoptSpawned()
+        {
+            void *address;
+
+            while (_count < MAX_COROUTINES && _spawned.tryPop(address))
+            {
+                for (unsigned int i = 0; i < MAX_COROUTINES; i++)
+                {
+                    if (!_slots[i])
+                    {
+                        _slots[i] = Coroutine::Handle::from_address(address);
+                        _count++;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Unregister from the primitive the coroutine waited on, unless another coroutine still waits on it
+        void releaseWaker(unsigned int slot)
+        {
+            detail::CoWait &wait = _slots[slot].promise().wait;
+            detail::Waker *waker = wait.waker;
+
+            if (waker == nullptr)
+                return;
+
+            wait.waker = nullptr;
+
+            for (unsigned int i = 0; i < MAX_COROUTINES; i++)
+            {
+                if (_slots[i] && _slots[i].promise().wait.waker == waker)
+                    return;
+            }
+
+            waker->clear(xTaskGetCurrentTaskHandle());
+        }
+
+        // Also shortens the sleep to the remaining time of a pending timeout
+        static bool isRunnable(detail::CoWait &wait, TickType_t now, TickType_t &sleep)
+        {
+            if (wait.poll == nullptr || wait.poll(wait.ctx))
+                return true;
+
+            if (wait.ticks == portMAX_DELAY)
+                return false;
+
+            const TickType_t elapsed = now - wait.start;
+            if (elapsed >= wait.ticks)
+                return true;
+
+            if (wait.ticks - elapsed < sleep)
+                sleep = wait.ticks - elapsed;
+
+            return false;
+        }
+
+        Coroutine::Handle _slots[MAX_COROUTINES];
+        unsigned int _count;
+        std::atomic<unsigned int> _reserved;
+        Queue<void *, MAX_COROUTINES> _spawned;
+    };
+}
+
+#endif // FRT_HAS_COROUTINES
+
+#endif // __FRT_COROUTINE_H__
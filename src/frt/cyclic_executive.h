@@ -0,0 +1,207 @@
+#ifndef __FRT_CYCLIC_EXECUTIVE_H__
+#define __FRT_CYCLIC_EXECUTIVE_H__
+
+#include "frt.h"
+#include "task.h"
+#include "periodic_task.h"
+
+namespace frt
+{
+    /**
+     *  Entry of a cyclic schedule. fn(arg) runs every period_ms, starting
+     *  offset_ms into the major frame.
+     */
+    struct CyclicSlot
+    {
+        uint32_t offset_ms;
+        uint32_t period_ms;
+        void (*fn)(void *arg);
+        void *arg;
+    };
+
+    enum class CyclicTick
+    {
+        FREERTOS, /**< Frames are released by the kernel tick */
+        EXTERNAL, /**< Frames are released by tick(), e.g. from a hardware timer ISR */
+    };
+
+    namespace detail
+    {
+        inline uint32_t gcd(uint32_t a, uint32_t b)
+        {
+            while (b != 0)
+            {
+                const uint32_t t = a % b;
+                a = b;
+                b = t;
+            }
+
+            return a;
+        }
+    }
+
+    /**
+     *  Time-triggered executive that runs a static schedule table on a
+     *  single task. The minor frame is the greatest common divisor of all
+     *  offsets and periods, the major frame the least common multiple of
+     *  the periods. Every minor frame the slots that are due run in table
+     *  order, so their phase relative to each other is fixed and they need
+     *  no messaging between each other.
+     *
+     *  A frame whose slots do not finish before the next release is counted
+     *  as an overrun. The frames that were missed are skipped, so the
+     *  remaining slots stay in phase with the frame clock.
+     *
+     *      static const frt::CyclicSlot schedule[] = {
+     *          {0, 10, filterTemperature, nullptr},
+     *          {2, 100, runPid, &pid},
+     *          {4, 100, scheduleOutput, nullptr},
+     *      };
+     *
+     *      frt::CyclicExecutive<> executive(schedule, 3);
+     *      executive.start(configMAX_PRIORITIES - 1, "cyclic");
+     */
+    template <unsigned int STACK_SIZE_BYTES = 2048>
+    class CyclicExecutive final : public Task<CyclicExecutive<STACK_SIZE_BYTES>, STACK_SIZE_BYTES>
+    {
+    public:
+        CyclicExecutive(const CyclicSlot *table, size_t count, CyclicTick source = CyclicTick::FREERTOS) : _table(table),
+                                                                                                           _count(count),
+                                                                                                           _source(source),
+                                                                                                           _minor_ms(0),
+                                                                                                           _major_ms(1),
+                                                                                                           _minor_ticks(0),
+                                                                                                           _last_wake(0),
+                                                                                                           _frame(0),
+                                                                                                           _started(false),
+                                                                                                           _overruns(0),
+                                                                                                           _skipped(0),
+                                                                                                           _max_frame_cycles(0)
+        {
+            assert(count > 0);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                assert(table[i].period_ms > 0 && table[i].offset_ms < table[i].period_ms);
+
+                _minor_ms = detail::gcd(detail::gcd(_minor_ms, table[i].period_ms), table[i].offset_ms);
+                _major_ms = _major_ms / detail::gcd(_major_ms, table[i].period_ms) * table[i].period_ms;
+            }
+
+            _minor_ticks = max(1U, (unsigned int)pdMS_TO_TICKS(_minor_ms));
+
+            if (source == CyclicTick::FREERTOS && _minor_ticks * portTICK_PERIOD_MS != _minor_ms)
+                FRT_LOG_WARN("Minor frame of %u ms is not a multiple of the tick period", _minor_ms);
+        }
+
+        // Period in which tick() has to be called with CyclicTick::EXTERNAL
+        uint32_t minorFrame() const { return _minor_ms; }
+        uint32_t majorFrame() const { return _major_ms; }
+
+        // Release the next frame, for CyclicTick::EXTERNAL. Can be called from an ISR.
+        void tick()
+        {
+            this->post();
+        }
+
+        // Number of executed minor frames
+        uint32_t frames() const { return _frame - _skipped; }
+
+        // Number of frames that ran into the release of the next one
+        uint32_t overruns() const { return _overruns; }
+
+        // Number of frames dropped because of overruns
+        uint32_t skipped() const { return _skipped; }
+
+        // Longest execution time of a frame in microseconds
+        uint32_t maxFrameTime() const { return detail::cyclesToMicros(_max_frame_cycles); }
+
+        void init() override
+        {
+            detail::enableCycleCounter();
+        }
+
+        bool run() override final
+        {
+            if (_source == CyclicTick::EXTERNAL)
+            {
+                // Woken up without a release, e.g. by Task::requestStop()
+                if (ulTaskNotifyTake(pdFALSE, portMAX_DELAY) == 0)
+                    return true;
+            }
+            else if (!_started)
+            {
+                _last_wake = xTaskGetTickCount();
+                _started = true;
+            }
+            else
+            {
+                FRT_DELAY_UNTIL(&_last_wake, _minor_ticks);
+            }
+
+            const uint32_t start = detail::cycleCount();
+            const uint32_t position = (_frame % (_major_ms / _minor_ms)) * _minor_ms;
+
+            for (size_t i = 0; i < _count; i++)
+            {
+                const CyclicSlot &slot = _table[i];
+
+                if (position >= slot.offset_ms && (position - slot.offset_ms) % slot.period_ms == 0)
+                    slot.fn(slot.arg);
+            }
+
+            const uint32_t cycles = detail::cycleCount() - start;
+            if (cycles > _max_frame_cycles)
+                _max_frame_cycles = cycles;
+
+            _frame++;
+            skipMissedFrames();
+
+            return true;
+        }
+
+    private:
+        void skipMissedFrames()
+        {
+            uint32_t missed = 0;
+
+            if (_source == CyclicTick::FREERTOS)
+            {
+                const TickType_t elapsed = xTaskGetTickCount() - _last_wake;
+
+                if (elapsed >= _minor_ticks)
+                {
+                    missed = elapsed / _minor_ticks;
+                    _last_wake += missed * _minor_ticks;
+                }
+            }
+            else
+            {
+                // Every release still pending is a frame that has already started
+                missed = ulTaskNotifyTake(pdTRUE, 0);
+            }
+
+            if (missed > 0)
+            {
+                _overruns++;
+                _skipped += missed;
+                _frame += missed;
+            }
+        }
+
+        const CyclicSlot *_table;
+        size_t _count;
+        CyclicTick _source;
+        uint32_t _minor_ms;
+        uint32_t _major_ms;
+        TickType_t _minor_ticks;
+        TickType_t _last_wake;
+        uint32_t _frame;
+        bool _started;
+        uint32_t _overruns;
+        uint32_t _skipped;
+        uint32_t _max_frame_cycles;
+    };
+}
+
+#endif // __FRT_CYCLIC_EXECUTIVE_H__
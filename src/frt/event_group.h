@@ -36,6 +36,10 @@ namespace frt
 
                 if (bitsSet != pdFAIL)
                 {
+                    // The timer daemon sets the bits, so the wake is queued behind it
+                    if (_waker.armed())
+                        xTimerPendFunctionCallFromISR(wakeFromDaemon, this, 0, &taskWoken);
+
                     detail::yieldFromIsr(taskWoken);
                 }
 #else
@@ -43,8 +47,17 @@ namespace frt
 #endif
                 return bitsSet;
             }
-            else
-                return xEventGroupSetBits(handle, bitsToSet);
+
+            const EventBits_t bits = xEventGroupSetBits(handle, bitsToSet);
+            _waker.wake();
+
+            return bits;
+        }
+
+        // Notified after every setBits()
+        detail::Waker &waker()
+        {
+            return _waker;
         }
 
         EventBits_t getBits()
@@ -106,7 +119,13 @@ namespace frt
         }
 
     private:
+        static void wakeFromDaemon(void *group, uint32_t)
+        {
+            static_cast<EventGroup *>(group)->_waker.wake();
+        }
+
         EventGroupHandle_t handle;
+        detail::Waker _waker;
 #if configSUPPORT_STATIC_ALLOCATION > 0
         StaticEventGroup_t buffer;
 #endif
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <assert.h>
+#include <atomic>
 
 #if defined(STM32F1) || defined(STM32F2) || defined(STM32F4) || defined(STM32U5)
 #define STM32
@@ -34,6 +35,20 @@
 
 #define FRT_TASK_NOTIFY_INDEX 0
 
+#if defined(ESP32) && !defined(CONFIG_FREERTOS_UNICORE) && (portNUM_PROCESSORS > 1)
+#define FRT_NUM_CORES portNUM_PROCESSORS
+#define FRT_CORE_DELIVERY 1
+#else
+#define FRT_NUM_CORES 1
+#define FRT_CORE_DELIVERY 0
+#endif
+
+#define FRT_NO_AFFINITY -1
+
+#if defined(ESP32)
+#include <esp_cpu.h>
+#endif
+
 #ifndef FRT_UNUSED
 #define FRT_UNUSED(expr)      \
         do                    \
@@ -185,6 +200,115 @@ namespace frt
 #endif
 #endif
                 }
+
+                // Priority of the calling task, or the idle priority if there is no calling task yet
+                inline UBaseType_t callerPriority()
+                {
+                        if (FRT_IS_ISR() || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+                                return tskIDLE_PRIORITY;
+
+                        return uxTaskPriorityGet(NULL);
+                }
+
+                // Core the calling task is pinned to, or FRT_NO_AFFINITY if it may run on any core
+                inline BaseType_t callerCore()
+                {
+#if FRT_CORE_DELIVERY
+                        if (FRT_IS_ISR() || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+                                return FRT_NO_AFFINITY;
+
+                        BaseType_t core = xTaskGetAffinity(NULL);
+                        return core == tskNO_AFFINITY ? FRT_NO_AFFINITY : core;
+#else
+                        return FRT_NO_AFFINITY;
+#endif
+                }
+
+                // Start the free-running cycle counter, only needed once on Cortex-M
+                inline void enableCycleCounter()
+                {
+#if !defined(ESP32)
+                        CoreDebug->DEMCR = CoreDebug->DEMCR | CoreDebug_DEMCR_TRCENA_Msk;
+                        DWT->CTRL = DWT->CTRL | DWT_CTRL_CYCCNTENA_Msk;
+#endif
+                }
+
+                // CPU clock cycles, wraps around. The ESP32 counter is per core.
+                inline uint32_t cycleCount() __attribute__((always_inline));
+                uint32_t cycleCount()
+                {
+#if defined(ESP32)
+                        return esp_cpu_get_ccount();
+#else
+                        return DWT->CYCCNT;
+#endif
+                }
+
+                inline uint32_t cyclesToMicros(uint32_t cycles)
+                {
+#if defined(ESP32)
+                        return cycles / getCpuFrequencyMhz();
+#else
+                        return cycles / (SystemCoreClock / 1000000U);
+#endif
+                }
+
+                inline uint32_t microsToCycles(uint32_t usecs)
+                {
+#if defined(ESP32)
+                        return usecs * getCpuFrequencyMhz();
+#else
+                        return usecs * (SystemCoreClock / 1000000U);
+#endif
+                }
+
+                /**
+                 *  Task to notify when a queue, semaphore or event group becomes
+                 *  ready. A coroutine scheduler registers itself while one of its
+                 *  coroutines waits on the primitive, so it can block instead of
+                 *  polling. Only one task is registered at a time.
+                 */
+                class Waker final
+                {
+                public:
+                        Waker() : _task(nullptr) {}
+
+                        void set(TaskHandle_t task)
+                        {
+                                _task.store(task, std::memory_order_release);
+                        }
+
+                        // Unregister, unless another task registered in the meantime
+                        void clear(TaskHandle_t task)
+                        {
+                                _task.compare_exchange_strong(task, nullptr, std::memory_order_acq_rel);
+                        }
+
+                        bool armed() const
+                        {
+                                return _task.load(std::memory_order_acquire) != nullptr;
+                        }
+
+                        void wake()
+                        {
+                                const TaskHandle_t task = _task.load(std::memory_order_acquire);
+
+                                if (task == nullptr)
+                                        return;
+
+                                if (FRT_IS_ISR())
+                                {
+                                        BaseType_t taskWoken = pdFALSE;
+                                        vTaskNotifyGiveFromISR(task, &taskWoken);
+                                        yieldFromIsr(taskWoken);
+                                }
+                                else
+                                        xTaskNotifyGive(task);
+                        }
+
+                private:
+                        std::atomic<TaskHandle_t> _task;
+                };
         }
 
         inline void spin() __attribute__((always_inline));
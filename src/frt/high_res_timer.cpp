@@ -0,0 +1,217 @@
+// Builds the fallback without the warning meant for sketches that use the timer
+#define FRT_HIGH_RES_TIMER_IMPL
+#include "high_res_timer.h"
+#include "log.h"
+
+using namespace frt;
+
+// Runs in the timer interrupt with HighResDispatch::ISR
+#if defined(ESP32)
+#define HIRES_ISR_ATTR IRAM_ATTR
+#else
+#define HIRES_ISR_ATTR
+#endif
+
+#if defined(ESP32)
+HighResTimer::HighResTimer(const char *name, HighResDispatch dispatch) : _handle(nullptr),
+                                                                         _dispatch(dispatch),
+                                                                         _active(false),
+                                                                         _periodic(false),
+                                                                         _dropped(0),
+                                                                         _generation(0),
+                                                                         _deferred(0)
+{
+    esp_timer_create_args_t args = {};
+    args.callback = espTimerCallback;
+    args.arg = this;
+    args.name = name;
+    args.dispatch_method = ESP_TIMER_TASK;
+
+#if defined(CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD)
+    if (dispatch == HighResDispatch::ISR)
+        args.dispatch_method = ESP_TIMER_ISR;
+#else
+    if (dispatch == HighResDispatch::ISR)
+        FRT_LOG_WARN("[ %s ] ISR dispatch is not enabled, callbacks run in the esp_timer task", name);
+#endif
+
+    if (esp_timer_create(&args, &_handle) != ESP_OK)
+        FRT_LOG_ERROR("[ %s ] High resolution timer initialization failed", name);
+}
+
+HighResTimer::~HighResTimer()
+{
+    if (_handle == nullptr)
+        return;
+
+    esp_timer_stop(_handle);
+    esp_timer_delete(_handle);
+    drainDeferred();
+}
+
+bool HighResTimer::arm(uint32_t usecs, bool periodic)
+{
+    if (_handle == nullptr)
+        return false;
+
+    // Starting a running esp_timer fails, so restart it
+    esp_timer_stop(_handle);
+
+    _periodic = periodic;
+    _active = true;
+    _generation++;
+
+    const esp_err_t err = periodic ? esp_timer_start_periodic(_handle, usecs) : esp_timer_start_once(_handle, usecs);
+    if (err != ESP_OK)
+        _active = false;
+
+    return err == ESP_OK;
+}
+
+bool HighResTimer::stop()
+{
+    _active = false;
+    _generation++;
+
+    return _handle != nullptr && esp_timer_stop(_handle) == ESP_OK;
+}
+
+void HIRES_ISR_ATTR HighResTimer::espTimerCallback(void *timer)
+{
+    static_cast<HighResTimer *>(timer)->expire();
+}
+#elif defined(STM32)
+HighResTimer::HighResTimer(const char *name, TIM_TypeDef *instance, HighResDispatch dispatch) : _hw(new HardwareTimer(instance)),
+                                                                                                _dispatch(dispatch),
+                                                                                                _active(false),
+                                                                                                _periodic(false),
+                                                                                                _dropped(0),
+                                                                                                _generation(0),
+                                                                                                _deferred(0)
+{
+    FRT_UNUSED(name);
+    _hw->attachInterrupt([this]()
+                         { expire(); });
+}
+
+HighResTimer::~HighResTimer()
+{
+    _hw->pause();
+    _hw->detachInterrupt();
+    delete _hw;
+    drainDeferred();
+}
+
+bool HighResTimer::arm(uint32_t usecs, bool periodic)
+{
+    _hw->pause();
+
+    _periodic = periodic;
+    _active = true;
+    _generation++;
+
+    // HardwareTimer picks the prescaler, the first expiry is a full period after resume()
+    _hw->setOverflow(usecs, MICROSEC_FORMAT);
+    _hw->setCount(0);
+    _hw->refresh();
+    _hw->resume();
+
+    return true;
+}
+
+bool HighResTimer::stop()
+{
+    _active = false;
+    _generation++;
+    _hw->pause();
+
+    return true;
+}
+#else
+HighResTimer::HighResTimer(const char *name, HighResDispatch dispatch) : _dispatch(dispatch),
+                                                                         _active(false),
+                                                                         _periodic(false),
+                                                                         _dropped(0),
+                                                                         _generation(0),
+                                                                         _deferred(0)
+{
+    FRT_UNUSED(name);
+}
+
+HighResTimer::~HighResTimer()
+{
+}
+
+bool HighResTimer::arm(uint32_t usecs, bool periodic)
+{
+    FRT_UNUSED(usecs);
+    FRT_UNUSED(periodic);
+
+    return false;
+}
+
+bool HighResTimer::stop()
+{
+    return false;
+}
+#endif
+
+bool HighResTimer::once(uint32_t usecs)
+{
+    return arm(usecs, false);
+}
+
+bool HighResTimer::every(uint32_t usecs)
+{
+    return arm(usecs, true);
+}
+
+void HIRES_ISR_ATTR HighResTimer::expire()
+{
+    if (!_periodic)
+    {
+        _active = false;
+#if defined(STM32)
+        _hw->pause();
+#endif
+    }
+
+    if (_dispatch == HighResDispatch::TASK && FRT_IS_ISR())
+    {
+        BaseType_t taskWoken = pdFALSE;
+
+        _deferred++;
+
+        if (xTimerPendFunctionCallFromISR(runDeferred, this, _generation, &taskWoken) != pdPASS)
+        {
+            _deferred--;
+            _dropped = _dropped + 1;
+        }
+
+        detail::yieldFromIsr(taskWoken);
+        return;
+    }
+
+    if (_fn)
+        _fn();
+}
+
+void HighResTimer::runDeferred(void *timer, uint32_t generation)
+{
+    HighResTimer *self = static_cast<HighResTimer *>(timer);
+
+    // Stopped or rearmed since this expiry
+    if (self->_fn && self->_generation == generation)
+        self->_fn();
+
+    self->_deferred--;
+}
+
+void HighResTimer::drainDeferred()
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+        return;
+
+    while (_deferred > 0)
+        vTaskDelay(1);
+}
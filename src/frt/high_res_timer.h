@@ -0,0 +1,101 @@
+#ifndef __FRT_HIGH_RES_TIMER_H__
+#define __FRT_HIGH_RES_TIMER_H__
+
+#include <atomic>
+#include <utility>
+
+#include "frt.h"
+#include "inline_function.h"
+
+#if defined(ESP32)
+#include <esp_timer.h>
+#elif !defined(STM32) && !defined(FRT_HIGH_RES_TIMER_IMPL)
+#warning "HighResTimer is not implemented yet for this platform"
+#endif
+
+#define FRT_HIRES_CALLBACK_CAPACITY 16
+
+namespace frt
+{
+    enum class HighResDispatch
+    {
+        ISR,  /**< The callback runs in the timer interrupt and must be ISR safe */
+        TASK, /**< The callback is deferred to a task, the esp_timer task on the ESP32, the timer daemon elsewhere */
+    };
+
+    /**
+     *  One shot or periodic timer with microsecond resolution, independent
+     *  of the FreeRTOS tick. It is backed by esp_timer on the ESP32 and by a
+     *  HardwareTimer instance on the STM32, which the timer then owns.
+     *
+     *      frt::HighResTimer pulse("pulse", TIM2);  // STM32
+     *      frt::HighResTimer pulse("pulse");        // ESP32
+     *
+     *      pulse.setCallback([] { digitalWrite(TRIAC_PIN, HIGH); });
+     *      pulse.once(PULSE_DELAY_US);              // e.g. from the zero cross ISR
+     *
+     *  On the ESP32 an ISR callback has to be placed in IRAM and requires
+     *  CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD, otherwise it is
+     *  deferred to the esp_timer task.
+     *
+     *  A deferred callback is skipped if the timer was stopped or rearmed
+     *  since the expiry. The destructor waits for deferred callbacks that
+     *  are still queued, so the timer must not be destroyed from one.
+     */
+    class HighResTimer final
+    {
+    public:
+#if defined(STM32)
+        HighResTimer(const char *name, TIM_TypeDef *instance, HighResDispatch dispatch = HighResDispatch::ISR);
+#else
+        explicit HighResTimer(const char *name, HighResDispatch dispatch = HighResDispatch::ISR);
+#endif
+        ~HighResTimer();
+
+        explicit HighResTimer(const HighResTimer &other) = delete;
+        HighResTimer &operator=(const HighResTimer &other) = delete;
+
+        // Replace the callback, only while the timer is stopped
+        template <typename F>
+        void setCallback(F &&fn)
+        {
+            _fn.assign(std::forward<F>(fn));
+        }
+
+        // Expire once after usecs, restarting a running timer. Can be called from an ISR.
+        bool once(uint32_t usecs);
+
+        // Expire every usecs, restarting a running timer. Can be called from an ISR.
+        bool every(uint32_t usecs);
+
+        bool stop();
+
+        bool isActive() const { return _active; }
+
+        // Expiries lost because the timer daemon queue was full, for HighResDispatch::TASK
+        uint32_t dropped() const { return _dropped; }
+
+    private:
+        bool arm(uint32_t usecs, bool periodic);
+        void expire();
+        static void runDeferred(void *timer, uint32_t generation);
+        void drainDeferred();
+
+#if defined(ESP32)
+        static void espTimerCallback(void *timer);
+
+        esp_timer_handle_t _handle;
+#elif defined(STM32)
+        HardwareTimer *_hw;
+#endif
+        HighResDispatch _dispatch;
+        InlineFunction<FRT_HIRES_CALLBACK_CAPACITY> _fn;
+        volatile bool _active;
+        volatile bool _periodic;
+        volatile uint32_t _dropped;
+        std::atomic<uint32_t> _generation; // Changed by every arm() and stop()
+        std::atomic<uint32_t> _deferred;   // Callbacks queued to the timer daemon
+    };
+}
+
+#endif // __FRT_HIGH_RES_TIMER_H__
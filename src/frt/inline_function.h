@@ -0,0 +1,93 @@
+#ifndef __FRT_INLINE_FUNCTION_H__
+#define __FRT_INLINE_FUNCTION_H__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace frt
+{
+    /**
+     *  Type-erased void() callable stored in a fixed-size buffer.
+     *  Unlike std::function it never allocates; a callable that does not fit
+     *  into CAPACITY bytes is rejected at compile time.
+     */
+    template <size_t CAPACITY>
+    class InlineFunction final
+    {
+    public:
+        InlineFunction() : _invoke(nullptr),
+                           _destroy(nullptr)
+        {
+        }
+
+        template <typename F>
+        InlineFunction(F &&fn) : _invoke(nullptr),
+                                 _destroy(nullptr)
+        {
+            assign(std::forward<F>(fn));
+        }
+
+        ~InlineFunction()
+        {
+            reset();
+        }
+
+        explicit InlineFunction(const InlineFunction &other) = delete;
+        InlineFunction &operator=(const InlineFunction &other) = delete;
+
+        template <typename F>
+        void assign(F &&fn)
+        {
+            typedef typename std::decay<F>::type Fn;
+            static_assert(sizeof(Fn) <= CAPACITY, "Callable does not fit into the inline buffer, capture less or raise the capacity");
+            static_assert(alignof(Fn) <= alignof(std::max_align_t), "Callable is over-aligned");
+
+            reset();
+            new (_storage) Fn(std::forward<F>(fn));
+            _invoke = &invokeFn<Fn>;
+            _destroy = &destroyFn<Fn>;
+        }
+
+        void reset()
+        {
+            if (_destroy != nullptr)
+                _destroy(_storage);
+
+            _invoke = nullptr;
+            _destroy = nullptr;
+        }
+
+        explicit operator bool() const
+        {
+            return _invoke != nullptr;
+        }
+
+        void operator()()
+        {
+            _invoke(_storage);
+        }
+
+        static constexpr size_t capacity() { return CAPACITY; }
+
+    private:
+        template <typename Fn>
+        static void invokeFn(void *storage)
+        {
+            (*static_cast<Fn *>(storage))();
+        }
+
+        template <typename Fn>
+        static void destroyFn(void *storage)
+        {
+            static_cast<Fn *>(storage)->~Fn();
+        }
+
+        alignas(std::max_align_t) unsigned char _storage[CAPACITY];
+        void (*_invoke)(void *);
+        void (*_destroy)(void *);
+    };
+}
+
+#endif // __FRT_INLINE_FUNCTION_H__
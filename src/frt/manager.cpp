@@ -34,19 +34,20 @@ bool Manager::removePublisher(const char *topic)
     return deleted_pubs > 0;
 }
 
-bool frt::Manager::addTask(ITask *t, const char *name)
+bool frt::Manager::addTask(ITask *t)
 {
-    size_t key = hash_cstr_gnu(name);
+    LockGuard lock(mutex);
+    size_t key = reinterpret_cast<size_t>(t);
 
-    // Try to emplace this publisher
     auto ret = tasks.emplace(key, t);
 
     return ret.second;
 }
 
-bool frt::Manager::removeTask(const char *name)
+bool frt::Manager::removeTask(ITask *t)
 {
-    size_t key = hash_cstr_gnu(name);
+    LockGuard lock(mutex);
+    size_t key = reinterpret_cast<size_t>(t);
     size_t deleted_tasks = tasks.erase(key);
 
     return deleted_tasks > 0;
@@ -9,6 +9,9 @@
 
 #include "mutex.h"
 
+// Subscriber priority that is taken from the consuming task on its first receive
+#define FRT_PRIORITY_CONSUMER ((UBaseType_t)-1)
+
 namespace frt
 {
     class IPublisher;
@@ -46,9 +49,31 @@ namespace frt
         bool removePublisher(const char *topic);
 
         // std::map<size_t, ITask *> *getTasks() { return &tasks; }
+        // Not locked, use forEachTask() or task::Snapshot while tasks may start or stop
         std::unordered_map<size_t, ITask *> *getTasks() { return &tasks; }
-        bool addTask(ITask *t, const char *name);
-        bool removeTask(const char *name);
+        // Tasks are keyed by their address, so tasks with equal or colliding names do not replace each other
+        bool addTask(ITask *t);
+        bool removeTask(ITask *t);
+
+        // Call fn for every registered task while the registry is locked
+        template <typename F>
+        void forEachTask(F fn)
+        {
+            LockGuard lock(mutex);
+
+            for (auto &t : tasks)
+            {
+                fn(t.second);
+            }
+        }
+
+        // Call fn with the registry while it is locked, registered tasks cannot exit until fn returns
+        template <typename F>
+        void withTasks(F fn)
+        {
+            LockGuard lock(mutex);
+            fn(static_cast<const std::unordered_map<size_t, ITask *> &>(tasks));
+        }
 
         template <typename T, unsigned int QUEUE_SIZE = 10>
         Publisher<T, QUEUE_SIZE> *aquirePublisher(const char *topic)
@@ -92,11 +117,15 @@ namespace frt
         //     return pub;
         // }
 
+        /**
+         *  @param priority Priority of the consuming task for DeliveryOrder::PRIORITY,
+         *         FRT_PRIORITY_CONSUMER records it on the first receive of that task.
+         */
         template <typename T, unsigned int QUEUE_SIZE = 10>
-        Subscriber<T, QUEUE_SIZE> *aquireSubscriber(const char *topic)
+        Subscriber<T, QUEUE_SIZE> *aquireSubscriber(const char *topic, UBaseType_t priority = FRT_PRIORITY_CONSUMER)
         {
             Publisher<T, QUEUE_SIZE> *pub = aquirePublisher<T, QUEUE_SIZE>(topic);
-            Subscriber<T, QUEUE_SIZE> *sub = new Subscriber<T, QUEUE_SIZE>(topic);
+            Subscriber<T, QUEUE_SIZE> *sub = new Subscriber<T, QUEUE_SIZE>(topic, priority);
 
             pub->addSubscriber(sub);
 
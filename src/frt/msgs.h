@@ -1,6 +1,8 @@
 #ifndef __FRT_MSGS_H__
 #define __FRT_MSGS_H__
 
+#define FRT_MAX_TASK_STATS 8
+
 namespace frt
 {
     namespace msgs
@@ -30,6 +32,36 @@ namespace frt
             float ei;
             float ed;
         };
+
+        struct TaskStat
+        {
+            char name[12];
+            uint16_t cpu_permille; /**< Share of the CPU time of all cores over the last window */
+            uint16_t stack_free;   /**< Stack high-water mark in bytes */
+            uint8_t priority;
+            uint8_t state;
+        };
+
+        struct TaskStats : public Message
+        {
+            uint8_t count;
+            TaskStat tasks[FRT_MAX_TASK_STATS];
+        };
+
+        struct DeadlineMiss : public Message
+        {
+            char name[12];
+            uint32_t elapsed_us;  /**< Duration of the run() call that missed the deadline */
+            uint32_t deadline_us;
+        };
+
+        struct TaskFault : public Message
+        {
+            char name[12];
+            uint32_t silent_ms; /**< Time since the last check-in */
+            uint32_t misses;    /**< Missed check-in periods so far */
+            bool restarted;
+        };
     }
 }
 
@@ -28,9 +28,10 @@ namespace frt
 
         void lock()
         {
-            // TaskHandle_t t = xSemaphoreGetMutexHolder(handle);
-            xSemaphoreTake(handle, portMAX_DELAY);
-            // t = xSemaphoreGetMutexHolder(handle);
+            // Retry if the wait was aborted, e.g. by Task::requestStop()
+            while (xSemaphoreTake(handle, portMAX_DELAY) != pdTRUE)
+            {
+            }
         }
 
         void lock(unsigned int msecs)
@@ -105,6 +106,23 @@ namespace frt
             return xSemaphoreTake(handle, max(1U, (unsigned int)ticks)) == pdTRUE;
         }
 
+        // Take the semaphore only if it is available right now, usable from an ISR
+        bool tryWait()
+        {
+            if (FRT_IS_ISR())
+            {
+                BaseType_t taskWoken = pdFALSE;
+                const bool success = xSemaphoreTakeFromISR(handle, &taskWoken) == pdTRUE;
+
+                if (success)
+                    detail::yieldFromIsr(taskWoken);
+
+                return success;
+            }
+
+            return xSemaphoreTake(handle, 0) == pdTRUE;
+        }
+
         bool wait(unsigned int msecs, unsigned int &remainder)
         {
             msecs += remainder;
@@ -139,11 +157,21 @@ namespace frt
             else
                 success = xSemaphoreGive(handle); 
 
+            if (success)
+                _waker.wake();
+
             return success;              
         }
 
+        // Notified after every successful post
+        detail::Waker &waker()
+        {
+            return _waker;
+        }
+
     private:
         SemaphoreHandle_t handle;
+        detail::Waker _waker;
 #if configSUPPORT_STATIC_ALLOCATION > 0
         StaticSemaphore_t buffer;
 #endif
@@ -0,0 +1,300 @@
+#ifndef __FRT_NOTIFY_H__
+#define __FRT_NOTIFY_H__
+
+#include "frt.h"
+
+#include <string.h>
+#include <type_traits>
+
+#if defined(configTASK_NOTIFICATION_ARRAY_ENTRIES) && (configTASK_NOTIFICATION_ARRAY_ENTRIES > 2)
+#define FRT_NOTIFY_CHANNELS 1
+// The last notification index is shared by all channels of a task to implement waitAny()
+#define FRT_NOTIFY_ANY_INDEX (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)
+#else
+#define FRT_NOTIFY_CHANNELS 0
+#endif
+
+#if FRT_NOTIFY_CHANNELS
+
+namespace frt
+{
+    namespace detail
+    {
+        inline TickType_t notifyTicks(unsigned int msecs)
+        {
+            return msecs == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(msecs);
+        }
+
+        /**
+         *  Common part of the notification channels.
+         *  Index FRT_TASK_NOTIFY_INDEX stays reserved for Task::post()/wait(),
+         *  the last index is used to wake a task in waitAny(). Only channels
+         *  with WAIT_ANY mirror their signals there, as that costs a second
+         *  notification per signal.
+         */
+        template <UBaseType_t INDEX, bool WAIT_ANY>
+        class NotifyChannel
+        {
+            static_assert(INDEX != FRT_TASK_NOTIFY_INDEX, "Notification index is reserved for Task::post()/wait()");
+            static_assert(INDEX < FRT_NOTIFY_ANY_INDEX, "Notification index out of range, raise configTASK_NOTIFICATION_ARRAY_ENTRIES");
+
+        public:
+            static constexpr UBaseType_t index() { return INDEX; }
+            static constexpr uint32_t bit() { return 1UL << INDEX; }
+            static constexpr bool waitsAny() { return WAIT_ANY; }
+
+        protected:
+            explicit NotifyChannel(const TaskHandle_t *task) : _task(task)
+            {
+            }
+
+            bool notify(uint32_t value, eNotifyAction action)
+            {
+                const TaskHandle_t handle = *_task;
+                bool success = false;
+
+                if (handle == nullptr)
+                    return false;
+
+                if (FRT_IS_ISR())
+                {
+                    BaseType_t taskWoken = pdFALSE;
+                    success = xTaskNotifyIndexedFromISR(handle, INDEX, value, action, &taskWoken) == pdPASS;
+                    if (WAIT_ANY)
+                        xTaskNotifyIndexedFromISR(handle, FRT_NOTIFY_ANY_INDEX, bit(), eSetBits, &taskWoken);
+                    detail::yieldFromIsr(taskWoken);
+                }
+                else
+                {
+                    success = xTaskNotifyIndexed(handle, INDEX, value, action) == pdPASS;
+                    if (WAIT_ANY)
+                        xTaskNotifyIndexed(handle, FRT_NOTIFY_ANY_INDEX, bit(), eSetBits);
+                }
+
+                return success;
+            }
+
+            // Notification value of the owning task, without clearing it
+            uint32_t peek(UBaseType_t index = INDEX) const
+            {
+                const TaskHandle_t handle = *_task;
+
+                if (handle == nullptr)
+                    return 0;
+
+                return ulTaskNotifyValueClearIndexed(handle, index, 0);
+            }
+
+            const TaskHandle_t *_task;
+        };
+    }
+
+    /**
+     *  Counting notification, a lightweight replacement for a counting
+     *  semaphore. give() can be called from any task or ISR, take() only
+     *  from the task that owns the channel. Set WAIT_ANY to use the channel
+     *  with waitAny().
+     */
+    template <UBaseType_t INDEX, bool WAIT_ANY = false>
+    class CountingChannel final : public detail::NotifyChannel<INDEX, WAIT_ANY>
+    {
+    public:
+        explicit CountingChannel(const TaskHandle_t *task) : detail::NotifyChannel<INDEX, WAIT_ANY>(task)
+        {
+        }
+
+        bool give()
+        {
+            return this->notify(0, eIncrement);
+        }
+
+        /**
+         *  @param clear Reset the count to zero instead of decrementing it.
+         *  @return The count before it was decremented or cleared, 0 on timeout.
+         */
+        uint32_t take(unsigned int msecs = portMAX_DELAY, bool clear = false)
+        {
+            if (FRT_IS_ISR())
+                return 0;
+
+            return ulTaskNotifyTakeIndexed(INDEX, clear ? pdTRUE : pdFALSE, detail::notifyTicks(msecs));
+        }
+
+        bool pending() const
+        {
+            return this->peek() != 0;
+        }
+    };
+
+    /**
+     *  Bitmask notification, a lightweight replacement for an EventGroup
+     *  with a single waiter. Bits of several set() calls are ORed together.
+     *  Set WAIT_ANY to use the channel with waitAny().
+     */
+    template <UBaseType_t INDEX, bool WAIT_ANY = false>
+    class BitsChannel final : public detail::NotifyChannel<INDEX, WAIT_ANY>
+    {
+    public:
+        explicit BitsChannel(const TaskHandle_t *task) : detail::NotifyChannel<INDEX, WAIT_ANY>(task)
+        {
+        }
+
+        bool set(uint32_t bits)
+        {
+            return this->notify(bits, eSetBits);
+        }
+
+        // @return All bits set since the last wait, 0 on timeout. The bits are cleared.
+        uint32_t wait(unsigned int msecs = portMAX_DELAY)
+        {
+            uint32_t bits = 0;
+
+            if (FRT_IS_ISR())
+                return 0;
+
+            if (xTaskNotifyWaitIndexed(INDEX, 0, 0xFFFFFFFFUL, &bits, detail::notifyTicks(msecs)) != pdTRUE)
+                return 0;
+
+            return bits;
+        }
+
+        bool pending() const
+        {
+            return this->peek() != 0;
+        }
+    };
+
+    /**
+     *  Mailbox for a single value of up to 32 bits. A new value overwrites
+     *  one that has not been read yet, so the reader always gets the latest.
+     *  Whether a value is waiting is only tracked with WAIT_ANY, which
+     *  pending() and waitAny() need.
+     */
+    template <UBaseType_t INDEX, typename T = uint32_t, bool WAIT_ANY = false>
+    class ValueChannel final : public detail::NotifyChannel<INDEX, WAIT_ANY>
+    {
+        static_assert(sizeof(T) <= sizeof(uint32_t), "Value does not fit into a notification");
+        static_assert(std::is_trivially_copyable<T>::value, "Value has to be trivially copyable");
+
+    public:
+        explicit ValueChannel(const TaskHandle_t *task) : detail::NotifyChannel<INDEX, WAIT_ANY>(task)
+        {
+        }
+
+        bool overwrite(const T &value)
+        {
+            uint32_t raw = 0;
+            memcpy(&raw, &value, sizeof(T));
+
+            return this->notify(raw, eSetValueWithOverwrite);
+        }
+
+        bool wait(T &value, unsigned int msecs = portMAX_DELAY)
+        {
+            uint32_t raw = 0;
+
+            if (FRT_IS_ISR())
+                return false;
+
+            // Clear the pending marker first, so an overwrite that races with this read is not lost for waitAny()
+            if (WAIT_ANY)
+                ulTaskNotifyValueClearIndexed(nullptr, FRT_NOTIFY_ANY_INDEX, this->bit());
+
+            if (xTaskNotifyWaitIndexed(INDEX, 0, 0, &raw, detail::notifyTicks(msecs)) != pdTRUE)
+                return false;
+
+            // The value arrived while blocked and marked the channel again, clear that marker too.
+            // An overwrite that slipped in before the clear is taken here, as the reader gets the latest.
+            if (WAIT_ANY)
+            {
+                ulTaskNotifyValueClearIndexed(nullptr, FRT_NOTIFY_ANY_INDEX, this->bit());
+                xTaskNotifyWaitIndexed(INDEX, 0, 0, &raw, 0);
+            }
+
+            memcpy(&value, &raw, sizeof(T));
+
+            return true;
+        }
+
+        bool pending() const
+        {
+            static_assert(WAIT_ANY, "A value channel only tracks pending values with WAIT_ANY");
+            return (this->peek(FRT_NOTIFY_ANY_INDEX) & this->bit()) != 0;
+        }
+    };
+
+    namespace detail
+    {
+        template <typename... Channels>
+        struct AllWaitAny
+        {
+            static constexpr bool value = true;
+        };
+
+        template <typename Channel, typename... Channels>
+        struct AllWaitAny<Channel, Channels...>
+        {
+            static constexpr bool value = Channel::waitsAny() && AllWaitAny<Channels...>::value;
+        };
+
+        template <typename... Channels>
+        uint32_t pendingChannels(Channels &...channels)
+        {
+            uint32_t mask = 0;
+            const int expand[] = {0, (mask |= channels.pending() ? channels.bit() : 0, 0)...};
+            FRT_UNUSED(expand);
+
+            return mask;
+        }
+    }
+
+    /**
+     *  Block the calling task until at least one of its channels has a
+     *  pending notification. Nothing is consumed, the caller takes from the
+     *  reported channels afterwards with a zero timeout. All channels must be
+     *  created with WAIT_ANY, e.g. channel<frt::CountingChannel<1, true>>().
+     *
+     *      const uint32_t ready = frt::waitAny(100, samples, commands);
+     *      if (ready & samples.bit())
+     *          samples.take(0);
+     *
+     *  @return Mask of the bit() of every pending channel, 0 on timeout.
+     */
+    template <typename... Channels>
+    uint32_t waitAny(unsigned int msecs, Channels &...channels)
+    {
+        static_assert(detail::AllWaitAny<Channels...>::value, "waitAny() needs channels with WAIT_ANY");
+
+        const TickType_t ticks = detail::notifyTicks(msecs);
+        const TickType_t start = xTaskGetTickCount();
+
+        if (FRT_IS_ISR())
+            return 0;
+
+        for (;;)
+        {
+            const uint32_t ready = detail::pendingChannels(channels...);
+            if (ready != 0)
+                return ready;
+
+            TickType_t remaining = portMAX_DELAY;
+            if (ticks != portMAX_DELAY)
+            {
+                const TickType_t elapsed = xTaskGetTickCount() - start;
+                if (elapsed >= ticks)
+                    return 0;
+
+                remaining = ticks - elapsed;
+            }
+
+            // Any signal wakes us up, which may also be one for a channel that is not in the list
+            uint32_t bits;
+            if (xTaskNotifyWaitIndexed(FRT_NOTIFY_ANY_INDEX, 0, 0, &bits, remaining) != pdTRUE)
+                return detail::pendingChannels(channels...);
+        }
+    }
+}
+
+#endif // FRT_NOTIFY_CHANNELS
+
+#endif // __FRT_NOTIFY_H__
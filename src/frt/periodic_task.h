@@ -0,0 +1,127 @@
+#ifndef __FRT_PERIODIC_TASK_H__
+#define __FRT_PERIODIC_TASK_H__
+
+#include "frt.h"
+#include "task.h"
+
+#if (tskKERNEL_VERSION_MAJOR > 10) || ((tskKERNEL_VERSION_MAJOR == 10) && (tskKERNEL_VERSION_MINOR >= 4))
+#define FRT_DELAY_UNTIL(last_wake, period) xTaskDelayUntil(last_wake, period)
+#else
+#define FRT_DELAY_UNTIL(last_wake, period) vTaskDelayUntil(last_wake, period)
+#endif
+
+namespace frt
+{
+    enum class OverrunPolicy
+    {
+        CATCH_UP,   /**< Run every missed period back-to-back until the schedule is met again */
+        SKIP_AHEAD, /**< Drop missed periods and continue at the next period boundary */
+    };
+
+    /**
+     *  Task that calls tick() at a fixed rate.
+     *  Release points are absolute (PERIOD_MS apart from the first run), so the
+     *  execution time of tick() does not accumulate as drift. A tick() that
+     *  runs into the next period is counted as an overrun and handled
+     *  according to the OverrunPolicy.
+     */
+    template <typename T, unsigned int PERIOD_MS, unsigned int STACK_SIZE_BYTES = 1024>
+    class PeriodicTask : public Task<T, STACK_SIZE_BYTES>
+    {
+        static_assert(PERIOD_MS > 0, "Period has to be greater than zero");
+
+    public:
+        PeriodicTask(OverrunPolicy policy = OverrunPolicy::SKIP_AHEAD) : _policy(policy),
+                                                                         _last_wake(0),
+                                                                         _started(false),
+                                                                         _cycles(0),
+                                                                         _overruns(0),
+                                                                         _skipped(0),
+                                                                         _max_lateness(0)
+        {
+        }
+
+        void setOverrunPolicy(OverrunPolicy policy)
+        {
+            _policy = policy;
+        }
+
+        static constexpr unsigned int period() { return PERIOD_MS; }
+
+        // Number of completed tick() calls
+        uint32_t cycles() const { return _cycles; }
+
+        // Number of tick() calls that did not finish within one period of their release. In
+        // OverrunPolicy::CATCH_UP mode a late cycle is released when the previous one finished.
+        uint32_t overruns() const { return _overruns; }
+
+        // Number of periods dropped in OverrunPolicy::SKIP_AHEAD mode
+        uint32_t skipped() const { return _skipped; }
+
+        // Largest delay between a release point and the actual wake-up in ticks
+        TickType_t maxLateness() const { return _max_lateness; }
+
+        bool run() override final
+        {
+            const TickType_t period = max(1U, (unsigned int)pdMS_TO_TICKS(PERIOD_MS));
+
+            if (!_started)
+            {
+                _last_wake = xTaskGetTickCount();
+                _started = true;
+            }
+            else
+            {
+                FRT_DELAY_UNTIL(&_last_wake, period);
+            }
+
+            const TickType_t woke = xTaskGetTickCount();
+            const TickType_t lateness = woke - _last_wake;
+            if (lateness > _max_lateness)
+                _max_lateness = lateness;
+
+            // A cycle that catches up on a missed period is released when the one before it finished,
+            // so its own overrun is measured from there and not from the release point it lags behind
+            const TickType_t release = (_policy == OverrunPolicy::CATCH_UP && lateness >= period) ? woke : _last_wake;
+
+            const bool res = tick();
+            _cycles++;
+
+            const TickType_t now = xTaskGetTickCount();
+            if (now - release >= period)
+            {
+                _overruns++;
+
+                if (_policy == OverrunPolicy::SKIP_AHEAD)
+                {
+                    // Move to the last release point that has already passed, so the
+                    // next wake-up is the first one still in the future
+                    const TickType_t missed = (now - _last_wake) / period;
+                    _last_wake += missed * period;
+                    _skipped += missed;
+                }
+            }
+
+            return res;
+        }
+
+    protected:
+        /**
+         *  Implementation of the periodic work.
+         *
+         *  @return false to stop the task.
+         */
+        virtual bool tick() = 0;
+
+    private:
+        OverrunPolicy _policy;
+        TickType_t _last_wake;
+        bool _started;
+        uint32_t _cycles;
+        uint32_t _overruns;
+        uint32_t _skipped;
+        TickType_t _max_lateness;
+    };
+}
+
+#endif // __FRT_PERIODIC_TASK_H__
@@ -0,0 +1,550 @@
+#ifndef __FRT_PIPELINE_H__
+#define __FRT_PIPELINE_H__
+
+#include "frt.h"
+#include "task.h"
+#include "queue.h"
+
+#include <utility>
+
+// Poll interval of a worker whose stages have nothing to do, e.g. a source that returned false
+#define FRT_PIPELINE_IDLE_MS 10
+
+namespace frt
+{
+    namespace detail
+    {
+        // Untyped part of a Pipe, used for wake-ups and metrics
+        class PipeBase
+        {
+        public:
+            PipeBase() : _producer(nullptr),
+                         _consumer(nullptr),
+                         _high_water(0)
+            {
+            }
+
+            virtual ~PipeBase() {}
+
+            virtual unsigned int depth() const = 0;
+            virtual unsigned int occupancy() const = 0;
+
+            // Largest number of items that were waiting at once
+            unsigned int highWater() const { return _high_water; }
+
+            void setProducer(TaskHandle_t task) { _producer = task; }
+            void setConsumer(TaskHandle_t task) { _consumer = task; }
+
+        protected:
+            static void wake(TaskHandle_t task)
+            {
+                if (task == nullptr)
+                    return;
+
+                if (FRT_IS_ISR())
+                {
+                    BaseType_t taskWoken = pdFALSE;
+                    vTaskNotifyGiveFromISR(task, &taskWoken);
+                    detail::yieldFromIsr(taskWoken);
+                }
+                else if (task != xTaskGetCurrentTaskHandle())
+                {
+                    xTaskNotifyGive(task);
+                }
+            }
+
+            TaskHandle_t volatile _producer;
+            TaskHandle_t volatile _consumer;
+            unsigned int _high_water;
+        };
+
+        template <typename T>
+        class TypedPipe : public PipeBase
+        {
+        public:
+            virtual bool push(const T &item) = 0;
+            virtual bool pop(T &item) = 0;
+            virtual bool full() const = 0;
+        };
+    }
+
+    /**
+     *  Bounded queue between two pipeline stages. push() never blocks, a
+     *  full pipe makes the producing stage stall instead, which propagates
+     *  backpressure up to the source. Items can also be pushed from outside
+     *  the pipeline, including from an ISR.
+     */
+    template <typename T, unsigned int DEPTH>
+    class Pipe final : public detail::TypedPipe<T>
+    {
+    public:
+        bool push(const T &item) override
+        {
+            if (!_queue.push(item, 0))
+                return false;
+
+            const unsigned int occupancy = _queue.available();
+            if (occupancy > this->_high_water)
+                this->_high_water = occupancy;
+
+            this->wake(this->_consumer);
+
+            return true;
+        }
+
+        bool pop(T &item) override
+        {
+            const bool was_full = full();
+
+            if (!_queue.tryPop(item))
+                return false;
+
+            // The producer may be stalled on this pipe
+            if (was_full)
+                this->wake(this->_producer);
+
+            return true;
+        }
+
+        bool full() const override
+        {
+            return _queue.availableForWrite() == 0;
+        }
+
+        unsigned int depth() const override { return DEPTH; }
+        unsigned int occupancy() const override { return _queue.available(); }
+
+    private:
+        Queue<T, DEPTH> _queue;
+    };
+
+    struct StageMetrics
+    {
+        const char *name;
+        uint32_t processed;    /**< Items taken from the input */
+        uint32_t dropped;      /**< Items the stage function rejected or that found the output full */
+        uint32_t stalls;       /**< Passes in which the output was full */
+        uint32_t per_second;   /**< Throughput between the last two Pipeline::sample() calls */
+        uint32_t avg_us;       /**< Mean service time of the stage function */
+        uint32_t max_us;
+        unsigned int queued;   /**< Items waiting in the input pipe, 0 for a source */
+        unsigned int depth;    /**< Depth of the input pipe, 0 for a source */
+        unsigned int high_water;
+    };
+
+    /**
+     *  A single processing step of a Pipeline. Use makeSource(), makeFilter()
+     *  and makeSink() to create stages from functions or lambdas.
+     */
+    class IStage
+    {
+    public:
+        IStage(const char *name) : _name(name),
+                                   _processed(0),
+                                   _dropped(0),
+                                   _stalls(0),
+                                   _max_cycles(0),
+                                   _total_cycles(0)
+        {
+        }
+
+        virtual ~IStage() {}
+
+        // Process at most one item, returns false if there was nothing to do
+        virtual bool pump() = 0;
+
+        // Register the worker running this stage on the connected pipes
+        virtual void bind(TaskHandle_t worker) = 0;
+
+        virtual const detail::PipeBase *input() const { return nullptr; }
+
+        const char *name() const { return _name; }
+
+        StageMetrics metrics() const
+        {
+            const detail::PipeBase *in = input();
+            StageMetrics m;
+
+            m.name = _name;
+            m.processed = _processed;
+            m.dropped = _dropped;
+            m.stalls = _stalls;
+            m.per_second = 0;
+            m.avg_us = _processed > 0 ? detail::cyclesToMicros(static_cast<uint32_t>(_total_cycles / _processed)) : 0;
+            m.max_us = detail::cyclesToMicros(_max_cycles);
+            m.queued = in != nullptr ? in->occupancy() : 0;
+            m.depth = in != nullptr ? in->depth() : 0;
+            m.high_water = in != nullptr ? in->highWater() : 0;
+
+            return m;
+        }
+
+    protected:
+        void record(uint32_t start)
+        {
+            const uint32_t cycles = detail::cycleCount() - start;
+
+            _total_cycles += cycles;
+            if (cycles > _max_cycles)
+                _max_cycles = cycles;
+        }
+
+        const char *_name;
+        uint32_t _processed;
+        uint32_t _dropped;
+        uint32_t _stalls;
+        uint32_t _max_cycles;
+        uint64_t _total_cycles;
+    };
+
+    /**
+     *  First stage of a pipeline. F has the signature bool(Out &) and
+     *  returns false if no item is available.
+     */
+    template <typename Out, typename F>
+    class SourceStage final : public IStage
+    {
+    public:
+        SourceStage(const char *name, F fn) : IStage(name),
+                                              _fn(std::move(fn)),
+                                              _output(nullptr)
+        {
+        }
+
+        SourceStage &to(detail::TypedPipe<Out> &output)
+        {
+            _output = &output;
+            return *this;
+        }
+
+        bool pump() override
+        {
+            if (_output->full())
+            {
+                _stalls++;
+                return false;
+            }
+
+            Out out;
+            const uint32_t start = detail::cycleCount();
+
+            // Empty polls do not count towards the service time
+            if (!_fn(out))
+                return false;
+
+            record(start);
+            _processed++;
+
+            // Another producer on the pipe may have filled it since the check
+            if (!_output->push(out))
+                _dropped++;
+
+            return true;
+        }
+
+        void bind(TaskHandle_t worker) override
+        {
+            _output->setProducer(worker);
+        }
+
+    private:
+        F _fn;
+        detail::TypedPipe<Out> *_output;
+    };
+
+    /**
+     *  Intermediate stage. F has the signature bool(const In &, Out &) and
+     *  returns false to drop the item.
+     */
+    template <typename In, typename Out, typename F>
+    class FilterStage final : public IStage
+    {
+    public:
+        FilterStage(const char *name, F fn) : IStage(name),
+                                              _fn(std::move(fn)),
+                                              _input(nullptr),
+                                              _output(nullptr)
+        {
+        }
+
+        FilterStage &from(detail::TypedPipe<In> &input)
+        {
+            _input = &input;
+            return *this;
+        }
+
+        FilterStage &to(detail::TypedPipe<Out> &output)
+        {
+            _output = &output;
+            return *this;
+        }
+
+        bool pump() override
+        {
+            if (_output->full())
+            {
+                if (_input->occupancy() > 0)
+                    _stalls++;
+
+                return false;
+            }
+
+            In in;
+            if (!_input->pop(in))
+                return false;
+
+            Out out;
+            const uint32_t start = detail::cycleCount();
+            const bool keep = _fn(in, out);
+            record(start);
+
+            _processed++;
+
+            if (!keep || !_output->push(out))
+                _dropped++;
+
+            return true;
+        }
+
+        void bind(TaskHandle_t worker) override
+        {
+            _input->setConsumer(worker);
+            _output->setProducer(worker);
+        }
+
+        const detail::PipeBase *input() const override { return _input; }
+
+    private:
+        F _fn;
+        detail::TypedPipe<In> *_input;
+        detail::TypedPipe<Out> *_output;
+    };
+
+    // Last stage of a pipeline. F has the signature void(const In &).
+    template <typename In, typename F>
+    class SinkStage final : public IStage
+    {
+    public:
+        SinkStage(const char *name, F fn) : IStage(name),
+                                            _fn(std::move(fn)),
+                                            _input(nullptr)
+        {
+        }
+
+        SinkStage &from(detail::TypedPipe<In> &input)
+        {
+            _input = &input;
+            return *this;
+        }
+
+        bool pump() override
+        {
+            In in;
+            if (!_input->pop(in))
+                return false;
+
+            const uint32_t start = detail::cycleCount();
+            _fn(in);
+            record(start);
+
+            _processed++;
+
+            return true;
+        }
+
+        void bind(TaskHandle_t worker) override
+        {
+            _input->setConsumer(worker);
+        }
+
+        const detail::PipeBase *input() const override { return _input; }
+
+    private:
+        F _fn;
+        detail::TypedPipe<In> *_input;
+    };
+
+    template <typename Out, typename F>
+    SourceStage<Out, typename std::decay<F>::type> makeSource(const char *name, F &&fn)
+    {
+        return SourceStage<Out, typename std::decay<F>::type>(name, std::forward<F>(fn));
+    }
+
+    template <typename In, typename Out, typename F>
+    FilterStage<In, Out, typename std::decay<F>::type> makeFilter(const char *name, F &&fn)
+    {
+        return FilterStage<In, Out, typename std::decay<F>::type>(name, std::forward<F>(fn));
+    }
+
+    template <typename In, typename F>
+    SinkStage<In, typename std::decay<F>::type> makeSink(const char *name, F &&fn)
+    {
+        return SinkStage<In, typename std::decay<F>::type>(name, std::forward<F>(fn));
+    }
+
+    /**
+     *  Runs connected stages on a configurable number of worker tasks.
+     *  Stages on the same worker are fused: one pass hands an item through
+     *  all of them without a context switch. Heavy stages get a worker of
+     *  their own, which on the ESP32 is pinned to core index % FRT_NUM_CORES.
+     *  Moving a stage between workers does not change the stages or pipes.
+     *
+     *      frt::Pipe<Sample, 8> raw;
+     *      frt::Pipe<float, 8> filtered;
+     *      auto read = frt::makeSource<Sample>("read", readAdc);
+     *      auto smooth = frt::makeFilter<Sample, float>("smooth", movingAverage);
+     *      auto out = frt::makeSink<float>("out", publishTemperature);
+     *      read.to(raw);
+     *      smooth.from(raw).to(filtered);
+     *      out.from(filtered);
+     *
+     *      frt::Pipeline<3, 2> pipeline;
+     *      pipeline.add(read, 0);
+     *      pipeline.add(smooth, 1);
+     *      pipeline.add(out, 1);
+     *      pipeline.start(3, "sensor");
+     *
+     *  @tparam MAX_STAGES Maximum number of stages over all workers.
+     *  @tparam N_WORKERS Number of worker tasks, workers without stages are not started.
+     */
+    template <unsigned int MAX_STAGES, unsigned int N_WORKERS = 1, unsigned int STACK_SIZE_BYTES = 2048>
+    class Pipeline final
+    {
+    public:
+        Pipeline() : _count(0),
+                     _last_sample(0)
+        {
+            for (unsigned int i = 0; i < MAX_STAGES; i++)
+            {
+                _last_processed[i] = 0;
+                _rate[i] = 0;
+            }
+        }
+
+        explicit Pipeline(const Pipeline &other) = delete;
+        Pipeline &operator=(const Pipeline &other) = delete;
+
+        /**
+         *  Assign a stage to a worker. Stages run in the order they were
+         *  added, so add them from source to sink.
+         *
+         *  @return false if the pipeline is full, already started or the worker does not exist.
+         */
+        bool add(IStage &stage, unsigned int worker = 0)
+        {
+            if (_count >= MAX_STAGES || worker >= N_WORKERS || _workers[worker].isRunning())
+                return false;
+
+            _stages[_count++] = &stage;
+            _workers[worker].m_stages[_workers[worker].m_count++] = &stage;
+
+            return true;
+        }
+
+        void start(unsigned char priority = 1, const char *prefix = "pipe")
+        {
+            detail::enableCycleCounter();
+            _last_sample = millis();
+
+            for (unsigned int i = 0; i < N_WORKERS; i++)
+            {
+                if (_workers[i].m_count == 0)
+                    continue;
+
+                Worker::indexedName(_names[i], prefix, i);
+                _workers[i].start(priority, _names[i], FRT_NUM_CORES > 1 ? static_cast<BaseType_t>(i % FRT_NUM_CORES) : FRT_NO_AFFINITY);
+            }
+        }
+
+        void stop()
+        {
+            Worker::stopAll(_workers);
+        }
+
+        // Update the throughput figures, call periodically
+        void sample()
+        {
+            const uint32_t now = millis();
+            const uint32_t elapsed = now - _last_sample;
+
+            if (elapsed == 0)
+                return;
+
+            for (unsigned int i = 0; i < _count; i++)
+            {
+                const uint32_t processed = _stages[i]->metrics().processed;
+                _rate[i] = static_cast<uint32_t>((static_cast<uint64_t>(processed - _last_processed[i]) * 1000U) / elapsed);
+                _last_processed[i] = processed;
+            }
+
+            _last_sample = now;
+        }
+
+        unsigned int stages() const { return _count; }
+
+        StageMetrics metrics(unsigned int stage) const
+        {
+            StageMetrics m = _stages[stage]->metrics();
+            m.per_second = _rate[stage];
+
+            return m;
+        }
+
+        void report(Print &out) const
+        {
+            for (unsigned int i = 0; i < _count; i++)
+            {
+                const StageMetrics m = metrics(i);
+
+                out.printf("%-12s %6u/s avg %5u us max %5u us queue %u/%u (peak %u) dropped %u stalled %u\r\n",
+                           m.name, m.per_second, m.avg_us, m.max_us, m.queued, m.depth, m.high_water, m.dropped, m.stalls);
+            }
+        }
+
+    private:
+        class Worker final : public Task<Worker, STACK_SIZE_BYTES>
+        {
+        public:
+            Worker() : m_count(0) {}
+
+            void init() override
+            {
+                const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+                for (unsigned int i = 0; i < m_count; i++)
+                {
+                    m_stages[i]->bind(self);
+                }
+            }
+
+            bool run() override
+            {
+                bool worked = false;
+
+                for (unsigned int i = 0; i < m_count; i++)
+                {
+                    worked = m_stages[i]->pump() || worked;
+                }
+
+                // Pipes wake the worker when input arrives or a full output drains
+                if (!worked)
+                    ulTaskNotifyTake(pdTRUE, max(1U, (unsigned int)pdMS_TO_TICKS(FRT_PIPELINE_IDLE_MS)));
+
+                return true;
+            }
+
+            IStage *m_stages[MAX_STAGES];
+            unsigned int m_count;
+        };
+
+        Worker _workers[N_WORKERS];
+        IStage *_stages[MAX_STAGES];
+        unsigned int _count;
+        uint32_t _last_processed[MAX_STAGES];
+        uint32_t _rate[MAX_STAGES];
+        uint32_t _last_sample;
+        char _names[N_WORKERS][configMAX_TASK_NAME_LEN];
+    };
+}
+
+#endif // __FRT_PIPELINE_H__
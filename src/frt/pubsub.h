@@ -5,18 +5,50 @@
 #include <vector>
 #include <functional>
 #include <algorithm>
+#include <type_traits>
 
 #include "msgs.h"
 #include "queue.h"
+#include "core_relay.h"
 #include "manager.h"
 #include "event_group.h"
 
 namespace frt
 {
+    enum class DeliveryOrder
+    {
+        SUBSCRIPTION, /**< Deliver in the order the subscribers subscribed */
+        PRIORITY,     /**< Deliver to the highest priority subscriber first, retry full queues last */
+    };
+
+// Subscribers that are ordered by priority, further subscribers get messages in subscription order
+#define FRT_PRIORITY_MAX_SUBSCRIBERS 32
+
+    namespace detail
+    {
+        inline bool isExpired(const msgs::Message &msg, TickType_t max_age, std::true_type)
+        {
+            const TickType_t now = FRT_IS_ISR() ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+            return static_cast<TickType_t>(now - msg.timestamp) > max_age;
+        }
+
+        // Messages without a timestamp never expire
+        template <typename T>
+        inline bool isExpired(const T &, TickType_t, std::false_type)
+        {
+            return false;
+        }
+    }
+
     class IPublisher
     {
     public:
         virtual ~IPublisher() {}
+
+#if FRT_CORE_DELIVERY
+        // Deliver messages queued for subscribers on the given core, called by its CoreRelay
+        virtual void drainCore(BaseType_t core) = 0;
+#endif
     };
 
     template <typename T, unsigned int QUEUE_SIZE>
@@ -28,8 +60,21 @@ namespace frt
     private:
         char _topic[16];
         std::vector<Subscriber<T, QUEUE_SIZE> *> _subscribers;
+        DeliveryOrder _order;
+#if FRT_CORE_DELIVERY
+        // Cross-core rings indexed by [source core * FRT_NUM_CORES + destination core]
+        detail::SpscRing<T, FRT_CORE_RING_SIZE> *_rings;
+        volatile uint32_t _ring_drops;
+        // Guards the subscriber list against the relays, which walk it from their own tasks
+        Mutex _lock;
+#endif
 
-        Publisher(const char *topic)
+        Publisher(const char *topic) : _order(DeliveryOrder::SUBSCRIPTION)
+#if FRT_CORE_DELIVERY
+                                       ,
+                                       _rings(nullptr),
+                                       _ring_drops(0)
+#endif
         {
             strncpy(_topic, topic, sizeof(_topic));
         }
@@ -37,6 +82,9 @@ namespace frt
         ~Publisher()
         {
             _subscribers.clear();
+#if FRT_CORE_DELIVERY
+            delete[] _rings;
+#endif
         }
 
         explicit Publisher(const Publisher &other) = delete;
@@ -44,11 +92,17 @@ namespace frt
 
         void addSubscriber(Subscriber<T, QUEUE_SIZE> *sub)
         {
+#if FRT_CORE_DELIVERY
+            LockGuard lock(_lock);
+#endif
             _subscribers.push_back(sub);
         }
 
         bool removeSubscriber(Subscriber<T, QUEUE_SIZE> *sub)
         {
+#if FRT_CORE_DELIVERY
+            LockGuard lock(_lock);
+#endif
             auto it = std::find(_subscribers.begin(), _subscribers.end(), sub);
 
             if (it != _subscribers.end())
@@ -60,16 +114,301 @@ namespace frt
             return false;
         }
 
+        // Index of the highest priority subscriber in the mask, the first subscribed one among equals
+        size_t nextByPriority(uint32_t mask) const
+        {
+            size_t best = 0;
+            bool found = false;
+
+            for (size_t i = 0; mask != 0; i++, mask >>= 1)
+            {
+                if ((mask & 1U) && (!found || _subscribers[i]->priority() > _subscribers[best]->priority()))
+                {
+                    best = i;
+                    found = true;
+                }
+            }
+
+            return best;
+        }
+
+        /**
+         *  The order is picked per message from the priorities recorded right
+         *  now, so the subscriber list is never reordered under a concurrent
+         *  publisher and subscribers may record their priority late. The
+         *  bookkeeping is on the stack, which keeps publish() reentrant.
+         */
+        void publishByPriority(const T &msg, unsigned int msecs)
+        {
+            const size_t count = _subscribers.size();
+            const size_t ordered = min(count, static_cast<size_t>(FRT_PRIORITY_MAX_SUBSCRIBERS));
+            uint32_t pending = ordered < 32 ? (1UL << ordered) - 1 : 0xFFFFFFFFUL;
+            uint32_t deferred = 0;
+
+            while (pending != 0)
+            {
+                const size_t i = nextByPriority(pending);
+                pending &= ~(1UL << i);
+
+                if (!_subscribers[i]->trySend(msg))
+                    deferred |= 1UL << i;
+            }
+
+            for (size_t i = ordered; i < count; i++)
+            {
+                _subscribers[i]->send(msg, msecs);
+            }
+
+            while (deferred != 0)
+            {
+                const size_t i = nextByPriority(deferred);
+                deferred &= ~(1UL << i);
+
+                _subscribers[i]->send(msg, msecs);
+            }
+        }
+
+#if FRT_CORE_DELIVERY
+        void publishByCore(const T &msg, unsigned int msecs)
+        {
+            // Only a hint, an unpinned publisher may migrate until interrupts are masked
+            const BaseType_t local = xPortGetCoreID();
+            bool remote[FRT_NUM_CORES] = {};
+
+            for (Subscriber<T, QUEUE_SIZE> *&sub : _subscribers)
+            {
+                const BaseType_t core = sub->core();
+
+                if (core == FRT_NO_AFFINITY || core == local)
+                    sub->send(msg, msecs);
+                else
+                    remote[core] = true;
+            }
+
+            for (BaseType_t dst = 0; dst < FRT_NUM_CORES; dst++)
+            {
+                if (!remote[dst])
+                    continue;
+
+                // Masking interrupts on this core serialises all producers of the ring,
+                // the only consumer is the relay pinned to the destination core. The
+                // core is read masked, so the task cannot move to another core's ring.
+                UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+                const BaseType_t src = xPortGetCoreID();
+                bool queued = src != dst && _rings[src * FRT_NUM_CORES + dst].push(msg);
+                portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+
+                if (queued)
+                {
+                    CoreRelay::notify(dst);
+                    continue;
+                }
+
+                // A direct send would overtake the older messages in the ring, so drop instead
+                if (src != dst)
+                {
+                    _ring_drops = _ring_drops + 1;
+                    continue;
+                }
+
+                // An unpinned publisher moved to the destination core, its earlier messages may still be in a ring
+                for (Subscriber<T, QUEUE_SIZE> *&sub : _subscribers)
+                {
+                    if (sub->core() == dst)
+                        sub->send(msg, msecs);
+                }
+            }
+        }
+
+        void drainCore(BaseType_t core) override
+        {
+            LockGuard lock(_lock);
+            T msg;
+
+            for (BaseType_t src = 0; src < FRT_NUM_CORES; src++)
+            {
+                if (src == core)
+                    continue;
+
+                while (_rings[src * FRT_NUM_CORES + core].pop(msg))
+                {
+                    for (Subscriber<T, QUEUE_SIZE> *&sub : _subscribers)
+                    {
+                        if (sub->core() == core)
+                            sub->send(msg, 0);
+                    }
+                }
+            }
+        }
+#endif
+
     public:
         const char *topic() const { return _topic; }
+
+        DeliveryOrder deliveryOrder() const { return _order; }
+
+        /**
+         *  Select the order in which subscribers get a published message.
+         *  In DeliveryOrder::PRIORITY mode the first
+         *  FRT_PRIORITY_MAX_SUBSCRIBERS subscribers get it by the priority
+         *  recorded for each of them. A subscriber whose queue is full is
+         *  skipped and retried after everybody else got their copy.
+         *  PRIORITY cannot be combined with core-aware delivery.
+         *
+         *  @return false if core-aware delivery is enabled and PRIORITY was requested.
+         */
+        bool setDeliveryOrder(DeliveryOrder order)
+        {
+#if FRT_CORE_DELIVERY
+            if (order == DeliveryOrder::PRIORITY && _rings != nullptr)
+                return false;
+#endif
+            _order = order;
+
+            return true;
+        }
+
+        /**
+         *  Route messages for subscribers pinned to another core through
+         *  per-core-pair SPSC rings that are drained by a relay task on the
+         *  destination core. Subscribers on the publishing core, and those
+         *  without affinity, are still served directly. Does nothing on
+         *  single-core targets. Not available with DeliveryOrder::PRIORITY.
+         *
+         *  Every subscriber gets the messages in publishing order. A message
+         *  that finds its ring full is dropped for the subscribers on that
+         *  core and counted in ringDrops(). The order is only guaranteed for
+         *  publishers pinned to a core, an unpinned one that moves to the
+         *  destination core sends directly and may overtake its own messages
+         *  that are still in the ring.
+         *
+         *  @return true if core-aware delivery is active.
+         */
+        bool enableCoreDelivery()
+        {
+#if FRT_CORE_DELIVERY
+            if (_rings != nullptr)
+                return true;
+
+            if (_order == DeliveryOrder::PRIORITY)
+                return false;
+
+            detail::SpscRing<T, FRT_CORE_RING_SIZE> *rings = new detail::SpscRing<T, FRT_CORE_RING_SIZE>[FRT_NUM_CORES * FRT_NUM_CORES];
+            _rings = rings;
+
+            if (!CoreRelay::registerPublisher(this))
+            {
+                _rings = nullptr;
+                delete[] rings;
+                return false;
+            }
+
+            return true;
+#else
+            return false;
+#endif
+        }
+
+#if FRT_CORE_DELIVERY
+        // Messages dropped because a cross-core ring was full
+        uint32_t ringDrops() const { return _ring_drops; }
+#endif
+
         void publish(const T msg, unsigned int msecs = portMAX_DELAY / configTICK_RATE_HZ)
         {
+#if FRT_CORE_DELIVERY
+            if (_rings != nullptr)
+            {
+                publishByCore(msg, msecs);
+                return;
+            }
+#endif
+
+            if (_order == DeliveryOrder::PRIORITY)
+            {
+                publishByPriority(msg, msecs);
+                return;
+            }
+
             for (Subscriber<T, QUEUE_SIZE> *&sub : _subscribers)
             {
                 sub->send(msg, msecs);
             }
         }
 
+        /**
+         *  Publish a run of messages at once.
+         *  Each subscriber queue is filled with the whole run while the
+         *  scheduler is suspended, so a waiting subscriber is woken up only
+         *  once instead of once per message. Subscribers keep their overflow
+         *  behaviour: the oldest messages are dropped if the run does not fit.
+         *  Never blocks.
+         *
+         *  FreeRTOS queues copy item by item, so every message is still one
+         *  queue operation per subscriber. The run saves the wakeups and
+         *  context switches, not the copies.
+         *
+         *  In DeliveryOrder::PRIORITY mode the subscribers get the run by
+         *  priority. With core-aware delivery every message goes through
+         *  the rings, so subscribers on other cores are woken by their relay.
+         *
+         *  @param msgs Messages in publishing order.
+         *  @param n Number of messages.
+         */
+        void publishMany(const T *msgs, size_t n)
+        {
+            if (n == 0)
+                return;
+
+#if FRT_CORE_DELIVERY
+            if (_rings != nullptr)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    publishByCore(msgs[i], 0);
+                }
+
+                return;
+            }
+#endif
+
+            const bool suspend = !FRT_IS_ISR() && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+
+            if (suspend)
+                vTaskSuspendAll();
+
+            if (_order == DeliveryOrder::PRIORITY)
+            {
+                const size_t count = _subscribers.size();
+                const size_t ordered = min(count, static_cast<size_t>(FRT_PRIORITY_MAX_SUBSCRIBERS));
+                uint32_t pending = ordered < 32 ? (1UL << ordered) - 1 : 0xFFFFFFFFUL;
+
+                // sendMany() never fails, so there is nobody to retry
+                while (pending != 0)
+                {
+                    const size_t i = nextByPriority(pending);
+                    pending &= ~(1UL << i);
+
+                    _subscribers[i]->sendMany(msgs, n);
+                }
+
+                for (size_t i = ordered; i < count; i++)
+                {
+                    _subscribers[i]->sendMany(msgs, n);
+                }
+            }
+            else
+            {
+                for (Subscriber<T, QUEUE_SIZE> *&sub : _subscribers)
+                {
+                    sub->sendMany(msgs, n);
+                }
+            }
+
+            if (suspend)
+                xTaskResumeAll();
+        }
+
         friend class Manager;
     };
 
@@ -80,8 +419,21 @@ namespace frt
         typedef std::function<void(const T *)> SubscriberCallback;
         Queue<T, QUEUE_SIZE> _queue;
         char _topic[16];
+        UBaseType_t _priority;
+        bool _bind_priority;
+        bool _bound;
+        bool _bind_core;
+        BaseType_t _core;
+        TickType_t _max_age;
+        uint32_t _expired;
 
-        Subscriber(const char *topic)
+        Subscriber(const char *topic, UBaseType_t priority) : _priority(priority == FRT_PRIORITY_CONSUMER ? tskIDLE_PRIORITY : priority),
+                                                              _bind_priority(priority == FRT_PRIORITY_CONSUMER),
+                                                              _bound(false),
+                                                              _bind_core(true),
+                                                              _core(FRT_NO_AFFINITY),
+                                                              _max_age(0),
+                                                              _expired(0)
         {
             strncpy(_topic, topic, sizeof(_topic));
         }
@@ -94,12 +446,45 @@ namespace frt
         Subscriber &operator=(const Subscriber &other) = delete;
 
     public:
+        typedef T MessageType;
+
+        static constexpr unsigned int queueSize() { return QUEUE_SIZE; }
+
         const char *topic() const { return _topic; }
+
+        /**
+         *  Priority of the task consuming this subscription. Unless given
+         *  explicitly to subscribe(), it is recorded when that task receives
+         *  from the subscription for the first time, as services subscribe
+         *  from setup() before their task is started.
+         */
+        UBaseType_t priority() const { return _priority; }
+
+        /**
+         *  Core of the task consuming this subscription, FRT_NO_AFFINITY if
+         *  it is not pinned. Unless set with setCore(), it is recorded when
+         *  that task receives for the first time and used by publishers with
+         *  core-aware delivery.
+         */
+        BaseType_t core() const { return _core; }
+
+        void setCore(BaseType_t core)
+        {
+            _bind_core = false;
+            _core = (core >= 0 && core < FRT_NUM_CORES) ? core : FRT_NO_AFFINITY;
+        }
+
         bool addToSet(QueueSetHandle_t &setHandle)
         {
             return _queue.addToSet(setHandle);
         }
 
+        // Notified after every message that reaches the queue
+        detail::Waker &waker()
+        {
+            return _queue.waker();
+        }
+
         bool canReceive(QueueSetMemberHandle_t &memberHandle)
         {
             return _queue.isMember(memberHandle);
@@ -126,19 +511,174 @@ namespace frt
             }
         }
 
+        // Never blocks, so it may be called while the scheduler is suspended
+        void sendMany(const T *msgs, size_t n)
+        {
+            if (QUEUE_SIZE == 1)
+            {
+                _queue.override(msgs[n - 1]);
+                return;
+            }
+
+            // Messages that would be dropped anyway are not queued at all
+            size_t first = n > QUEUE_SIZE ? n - QUEUE_SIZE : 0;
+
+            for (size_t i = first; i < n; i++)
+            {
+                if (!_queue.push(msgs[i], 0))
+                {
+                    T temp;
+                    _queue.tryPop(temp);
+                    _queue.push(msgs[i], 0);
+                }
+            }
+        }
+
+        // Send without blocking and without dropping queued messages
+        bool trySend(const T &msg)
+        {
+            if (QUEUE_SIZE == 1)
+                return _queue.override(msg);
+
+            return _queue.push(msg, 0);
+        }
+
+        /**
+         *  Drop messages older than the given age on receive instead of
+         *  handing them to the consumer. The age is measured against
+         *  msgs::Message::timestamp, which has to be set in ticks by the
+         *  publisher, e.g. from xTaskGetTickCount().
+         *
+         *  All receive() overloads wait only for the first message. If that
+         *  one is stale they skip the stale messages already waiting without
+         *  waiting again, and return false if no fresh message is left.
+         *
+         *  @param msecs Maximum message age, 0 disables the check.
+         */
+        void setMaxAge(unsigned int msecs)
+        {
+            static_assert(std::is_base_of<msgs::Message, T>::value, "Maximum age needs a message type derived from msgs::Message");
+            _max_age = pdMS_TO_TICKS(msecs);
+        }
+
+        // Number of messages dropped because they were older than the maximum age
+        uint32_t expired() const { return _expired; }
+
         bool receive(T &msg)
         {
-            return _queue.pop(msg);
+            bindConsumer();
+
+            return _queue.pop(msg) && skipExpired(msg);
         }
 
         bool receive(T &msg, unsigned int msecs)
         {
-            return _queue.pop(msg, msecs);
+            bindConsumer();
+
+            return _queue.pop(msg, msecs) && skipExpired(msg);
         }
 
         bool receive(T &msg, unsigned int msecs, unsigned int &remainder)
         {
-            return _queue.pop(msg, msecs, remainder);
+            bindConsumer();
+
+            return _queue.pop(msg, msecs, remainder) && skipExpired(msg);
+        }
+
+        // Receive a waiting message that has not expired, never blocks
+        bool tryReceive(T &msg)
+        {
+            bindConsumer();
+
+            while (_queue.tryPop(msg))
+            {
+                if (!isExpired(msg))
+                    return true;
+            }
+
+            return false;
+        }
+
+        /**
+         *  Take all waiting messages and keep only the newest one that has
+         *  not expired. Never blocks.
+         *
+         *  @return true if a message was received.
+         */
+        bool receiveLatest(T &msg)
+        {
+            bool received = false;
+            T temp;
+
+            bindConsumer();
+
+            while (_queue.tryPop(temp))
+            {
+                if (!isExpired(temp))
+                {
+                    msg = temp;
+                    received = true;
+                }
+            }
+
+            return received;
+        }
+
+        /**
+         *  Wait for a message and then skip ahead to the newest one that is
+         *  waiting.
+         *
+         *  @param msecs How long to wait if no message is waiting.
+         *  @return true if a message was received.
+         */
+        bool receiveLatest(T &msg, unsigned int msecs)
+        {
+            if (receiveLatest(msg))
+                return true;
+
+            if (!receive(msg, msecs))
+                return false;
+
+            receiveLatest(msg);
+
+            return true;
+        }
+
+    private:
+        // The task that receives is the consumer, record its attributes once it runs
+        void bindConsumer()
+        {
+            if (_bound || FRT_IS_ISR() || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+                return;
+
+            _bound = true;
+
+            if (_bind_core)
+                _core = detail::callerCore();
+
+            if (_bind_priority)
+                _priority = detail::callerPriority();
+        }
+
+        // Replace a stale message by the next waiting one, without blocking, e.g. for a queue set member
+        bool skipExpired(T &msg)
+        {
+            while (isExpired(msg))
+            {
+                if (!_queue.tryPop(msg))
+                    return false;
+            }
+
+            return true;
+        }
+
+        bool isExpired(const T &msg)
+        {
+            if (_max_age == 0 || !detail::isExpired(msg, _max_age, std::is_base_of<msgs::Message, T>()))
+                return false;
+
+            _expired++;
+            return true;
         }
 
         friend class Manager;
@@ -164,6 +704,15 @@ namespace frt
 
             return sub;
         }
+
+        template <typename M, unsigned int QUEUE_SIZE = 10>
+        Subscriber<M, QUEUE_SIZE> *subscribe(const char *topic, UBaseType_t priority)
+        {
+            Manager *man = Manager::getInstance();
+            Subscriber<M, QUEUE_SIZE> *sub = man->aquireSubscriber<M, QUEUE_SIZE>(topic, priority);
+
+            return sub;
+        }
     }
 }
 
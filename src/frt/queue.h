@@ -54,6 +54,12 @@ namespace frt
             return &_handle;
         }
 
+        // Notified after every successful push
+        detail::Waker &waker()
+        {
+            return _waker;
+        }
+
         bool override(const T &item)
         {
             BaseType_t taskWoken = pdFALSE;
@@ -65,9 +71,10 @@ namespace frt
                 }
                 detail::yieldFromIsr(taskWoken);
             }
-            else
-                return xQueueOverwrite(_handle, &item);
+            else if (xQueueOverwrite(_handle, &item) != pdTRUE)
+                return false;
 
+            _waker.wake();
             return true;
         }
 
@@ -91,6 +98,7 @@ namespace frt
                 }
             }
 
+            _waker.wake();
             return true;
         }
 
@@ -117,6 +125,7 @@ namespace frt
                 }
             }
 
+            _waker.wake();
             return true;
         }
 
@@ -134,15 +143,17 @@ namespace frt
                 {
                     remainder = 0;
                     detail::yieldFromIsr(taskWoken);
+                    _waker.wake();
                     return true;
                 }
             }
             else
             {
                 // if (xQueueSend(_handle, &item, max(1U, (unsigned int)ticks)) == pdTRUE)
-                if (xQueueSend(_handle, &item, ticks) != pdTRUE)
+                if (xQueueSend(_handle, &item, ticks) == pdTRUE)
                 {
                     remainder = 0;
+                    _waker.wake();
                     return true;
                 }
             }
@@ -226,6 +237,30 @@ namespace frt
             return false;
         }
 
+        // Pop without blocking, also allowed while the scheduler is suspended
+        bool tryPop(T &item)
+        {
+            BaseType_t taskWoken = pdFALSE;
+
+            if (FRT_IS_ISR())
+            {
+                if (xQueueReceiveFromISR(_handle, &item, &taskWoken) != pdTRUE)
+                {
+                    return false;
+                }
+                detail::yieldFromIsr(taskWoken);
+            }
+            else
+            {
+                if (xQueueReceive(_handle, &item, 0) != pdTRUE)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
         bool peek(T &item)
         {
             BaseType_t taskWoken = pdFALSE;
@@ -304,6 +339,7 @@ namespace frt
 
     private:
         QueueHandle_t _handle;
+        detail::Waker _waker;
 #if configSUPPORT_STATIC_ALLOCATION > 0
         uint8_t buffer[QUEUE_SIZE * sizeof(T)];
         StaticQueue_t state;
@@ -0,0 +1,176 @@
+#include "rate_monotonic.h"
+
+#include <math.h>
+
+using namespace frt;
+
+bool RateMonotonic::add(ITask *task, uint32_t period_ms, uint32_t wcet_us, uint32_t deadline_ms)
+{
+    if (_count >= FRT_RMA_MAX_TASKS || period_ms == 0)
+        return false;
+
+    Entry &entry = _entries[_count++];
+    entry.task = task;
+    entry.period_us = period_ms * 1000U;
+    entry.wcet_us = wcet_us;
+    entry.deadline_us = (deadline_ms > 0 ? deadline_ms : period_ms) * 1000U;
+    entry.priority = tskIDLE_PRIORITY;
+    entry.response_us = 0;
+    entry.schedulable = false;
+
+    _analysed = false;
+
+    return true;
+}
+
+bool RateMonotonic::analyse(UBaseType_t lowest, UBaseType_t highest)
+{
+    // Sort by period, ties by deadline
+    for (size_t i = 1; i < _count; i++)
+    {
+        const Entry entry = _entries[i];
+        size_t j = i;
+
+        while (j > 0 && (_entries[j - 1].period_us > entry.period_us ||
+                         (_entries[j - 1].period_us == entry.period_us && _entries[j - 1].deadline_us > entry.deadline_us)))
+        {
+            _entries[j] = _entries[j - 1];
+            j--;
+        }
+
+        _entries[j] = entry;
+    }
+
+    UBaseType_t priority = highest;
+    _compressed = false;
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (i > 0 && _entries[i].period_us != _entries[i - 1].period_us)
+        {
+            if (priority > lowest)
+                priority--;
+            else
+                _compressed = true;
+        }
+
+        _entries[i].priority = priority;
+    }
+
+    if (_compressed)
+        FRT_LOG_WARN("Not enough priorities for %u periods, the longest periods share the lowest priority", (unsigned int)_count);
+
+    _schedulable = true;
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        responseTimeAnalysis(_entries[i]);
+        _schedulable = _schedulable && _entries[i].schedulable;
+    }
+
+    _analysed = true;
+
+    return _schedulable;
+}
+
+void RateMonotonic::responseTimeAnalysis(Entry &entry)
+{
+    // Fixed point of R = C + sum(ceil(R / T_j) * C_j) over all tasks j of equal or higher priority
+    uint64_t response = entry.wcet_us;
+
+    for (;;)
+    {
+        uint64_t next = entry.wcet_us;
+
+        for (size_t j = 0; j < _count; j++)
+        {
+            const Entry &other = _entries[j];
+
+            if (&other == &entry || other.priority < entry.priority)
+                continue;
+
+            next += ((response + other.period_us - 1) / other.period_us) * other.wcet_us;
+        }
+
+        if (next > entry.deadline_us)
+        {
+            entry.response_us = next > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(next);
+            entry.schedulable = false;
+            return;
+        }
+
+        if (next == response)
+            break;
+
+        response = next;
+    }
+
+    entry.response_us = static_cast<uint32_t>(response);
+    entry.schedulable = true;
+}
+
+void RateMonotonic::apply()
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        const TaskHandle_t handle = *_entries[i].task->handle();
+
+        if (handle != nullptr)
+            vTaskPrioritySet(handle, _entries[i].priority);
+    }
+}
+
+const RateMonotonic::Entry *RateMonotonic::find(const ITask *task) const
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].task == task)
+            return &_entries[i];
+    }
+
+    return nullptr;
+}
+
+UBaseType_t RateMonotonic::priority(const ITask *task) const
+{
+    const Entry *entry = find(task);
+    return entry != nullptr && _analysed ? entry->priority : tskIDLE_PRIORITY;
+}
+
+uint32_t RateMonotonic::responseTime(const ITask *task) const
+{
+    const Entry *entry = find(task);
+    return entry != nullptr && _analysed ? entry->response_us : 0;
+}
+
+uint32_t RateMonotonic::utilisation() const
+{
+    uint64_t permille = 0;
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        permille += static_cast<uint64_t>(_entries[i].wcet_us) * 1000U / _entries[i].period_us;
+    }
+
+    return static_cast<uint32_t>(permille);
+}
+
+void RateMonotonic::report(Print &out) const
+{
+    // Liu & Layland bound, sufficient but not necessary
+    const float bound = _count > 0 ? _count * (powf(2.0F, 1.0F / _count) - 1.0F) : 1.0F;
+
+    out.printf("Rate-monotonic analysis of %u tasks: %s, utilisation %u.%u%% (bound %u%%)\r\n",
+               (unsigned int)_count, _schedulable ? "schedulable" : "NOT schedulable",
+               (unsigned int)(utilisation() / 10), (unsigned int)(utilisation() % 10), (unsigned int)(bound * 100.0F));
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        const Entry &entry = _entries[i];
+        const char *name = entry.task->name();
+
+        out.printf("  %-16s prio %2u period %7u us wcet %7u us response %7u us deadline %7u us %s\r\n",
+                   name[0] != '\0' ? name : "-", (unsigned int)entry.priority, (unsigned int)entry.period_us, (unsigned int)entry.wcet_us,
+                   (unsigned int)entry.response_us, (unsigned int)entry.deadline_us, entry.schedulable ? "ok" : "MISS");
+    }
+}
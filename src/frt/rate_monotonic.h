@@ -0,0 +1,109 @@
+#ifndef __FRT_RATE_MONOTONIC_H__
+#define __FRT_RATE_MONOTONIC_H__
+
+#include <Arduino.h>
+
+#include "task.h"
+
+#define FRT_RMA_MAX_TASKS 16
+
+namespace frt
+{
+    /**
+     *  Assigns rate-monotonic priorities to a set of periodic tasks and
+     *  checks the set with exact response-time analysis. Tasks with a
+     *  shorter period get a higher priority, tasks with equal periods share
+     *  one. The analysis counts tasks of equal priority as interference in
+     *  both directions, because FreeRTOS time-slices between them.
+     *
+     *      frt::RateMonotonic rm;
+     *      rm.add(temp_svc, 50, 400);
+     *      rm.add(pid_svc, 100, 1500);
+     *
+     *      if (!rm.analyse())
+     *      {
+     *          rm.report(Serial);
+     *          abort();
+     *      }
+     *
+     *      temp_svc->start(rm.priority(temp_svc), "temperature");
+     *      pid_svc->start(rm.priority(pid_svc), "pid");
+     */
+    class RateMonotonic final
+    {
+    public:
+        RateMonotonic() : _count(0),
+                          _analysed(false),
+                          _schedulable(false),
+                          _compressed(false)
+        {
+        }
+
+        /**
+         *  Declare a periodic task.
+         *
+         *  @param period_ms Release period of the task.
+         *  @param wcet_us Worst-case execution time of one release.
+         *  @param deadline_ms Relative deadline, 0 uses the period.
+         *  @return false if FRT_RMA_MAX_TASKS tasks were added already.
+         */
+        bool add(ITask *task, uint32_t period_ms, uint32_t wcet_us, uint32_t deadline_ms = 0);
+
+#ifdef FRT_TASK_RUN_STATS
+        // Declare a task with the longest run() measured so far as its execution time
+        template <typename T, unsigned int STACK_SIZE_BYTES>
+        bool addMeasured(Task<T, STACK_SIZE_BYTES> *task, uint32_t period_ms, uint32_t deadline_ms = 0)
+        {
+            return add(task, period_ms, detail::cyclesToMicros(task->runStats().max_cycles), deadline_ms);
+        }
+#endif
+
+        /**
+         *  Assign the priorities and run the response-time analysis.
+         *
+         *  @param lowest Priority of the task with the longest period.
+         *  @param highest Priority of the task with the shortest period.
+         *  @return true if every task meets its deadline.
+         */
+        bool analyse(UBaseType_t lowest = tskIDLE_PRIORITY + 1, UBaseType_t highest = configMAX_PRIORITIES - 1);
+
+        // Set the assigned priorities on all tasks that are already running
+        void apply();
+
+        // Assigned priority, tskIDLE_PRIORITY for a task that was not added
+        UBaseType_t priority(const ITask *task) const;
+
+        // Worst-case response time in microseconds, 0 for a task that was not added
+        uint32_t responseTime(const ITask *task) const;
+
+        bool schedulable() const { return _schedulable; }
+
+        // Total utilisation of the task set in per mille
+        uint32_t utilisation() const;
+
+        void report(Print &out) const;
+
+    private:
+        struct Entry
+        {
+            ITask *task;
+            uint32_t period_us;
+            uint32_t wcet_us;
+            uint32_t deadline_us;
+            UBaseType_t priority;
+            uint32_t response_us;
+            bool schedulable;
+        };
+
+        const Entry *find(const ITask *task) const;
+        void responseTimeAnalysis(Entry &entry);
+
+        Entry _entries[FRT_RMA_MAX_TASKS];
+        size_t _count;
+        bool _analysed;
+        bool _schedulable;
+        bool _compressed;
+    };
+}
+
+#endif // __FRT_RATE_MONOTONIC_H__
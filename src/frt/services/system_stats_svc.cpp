@@ -0,0 +1,119 @@
+#include "system_stats_svc.h"
+#include "frt/periodic_task.h"
+
+#ifdef FRT_STACK_PROFILING
+#include "frt/stack_profiler.h"
+#endif
+
+using namespace frt;
+
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+SystemStatsService::SystemStatsService(unsigned int interval_ms) : _last_count(0),
+                                                                   _last_total(0),
+                                                                   _last_wake(0),
+                                                                   _interval_ms(interval_ms)
+{
+    _pub = pubsub::advertise<msgs::TaskStats, 1>(RECORD_TASK_STATS);
+}
+
+bool SystemStatsService::lastRunTime(TaskHandle_t handle, uint32_t &run_time) const
+{
+    for (size_t i = 0; i < _last_count; i++)
+    {
+        if (_last[i].handle == handle)
+        {
+            run_time = _last[i].run_time;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SystemStatsService::run()
+{
+    if (_last_wake == 0)
+        _last_wake = xTaskGetTickCount();
+
+    FRT_DELAY_UNTIL(&_last_wake, max(1U, (unsigned int)pdMS_TO_TICKS(_interval_ms)));
+
+    // Collect the handles of all registered tasks
+    TaskHandle_t registered[FRT_MAX_TASK_STATS];
+    size_t registered_count = 0;
+    size_t running = 0;
+
+    Manager::getInstance()->forEachTask(
+        [&](ITask *t)
+        {
+            if (*t->handle() == nullptr)
+                return;
+
+            if (registered_count < FRT_MAX_TASK_STATS)
+                registered[registered_count++] = *t->handle();
+
+            running++;
+        });
+
+    if (running > FRT_MAX_TASK_STATS)
+        FRT_LOG_WARN("%u tasks running, only %d reported, increase FRT_MAX_TASK_STATS", (unsigned int)running, FRT_MAX_TASK_STATS);
+
+    uint32_t total;
+    UBaseType_t count = uxTaskGetSystemState(_status, SYSTEM_STATS_MAX_TASKS, &total);
+
+    if (count == 0)
+    {
+        FRT_LOG_WARN("More than %d tasks, increase SYSTEM_STATS_MAX_TASKS", SYSTEM_STATS_MAX_TASKS);
+        return true;
+    }
+
+    // On SMP targets the counters of all cores add up to the total times the number of cores
+    const uint32_t window = (total - _last_total) * FRT_NUM_CORES;
+
+    msgs::TaskStats stats;
+    stats.timestamp = xTaskGetTickCount();
+    stats.count = 0;
+
+    Sample current[FRT_MAX_TASK_STATS];
+    size_t current_count = 0;
+
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        const TaskStatus_t &status = _status[i];
+
+        if (std::find(registered, registered + registered_count, status.xHandle) == registered + registered_count)
+            continue;
+
+        current[current_count].handle = status.xHandle;
+        current[current_count].run_time = status.ulRunTimeCounter;
+        current_count++;
+
+        // A task without a previous sample only gets one now, its counter covers more than this interval
+        uint32_t last_run_time;
+        if (!lastRunTime(status.xHandle, last_run_time))
+            continue;
+
+        const uint32_t run_time = status.ulRunTimeCounter - last_run_time;
+
+        msgs::TaskStat &stat = stats.tasks[stats.count];
+        strncpy(stat.name, status.pcTaskName, sizeof(stat.name) - 1);
+        stat.name[sizeof(stat.name) - 1] = '\0';
+        stat.cpu_permille = window > 0 ? static_cast<uint16_t>((static_cast<uint64_t>(run_time) * 1000) / window) : 0;
+        stat.stack_free = static_cast<uint16_t>(min(static_cast<uint32_t>(status.usStackHighWaterMark * sizeof(StackType_t)), static_cast<uint32_t>(UINT16_MAX)));
+        stat.priority = static_cast<uint8_t>(status.uxCurrentPriority);
+        stat.state = static_cast<uint8_t>(status.eCurrentState);
+        stats.count++;
+    }
+
+    memcpy(_last, current, sizeof(Sample) * current_count);
+    _last_count = current_count;
+    _last_total = total;
+
+    _pub->publish(stats, 0);
+
+#ifdef FRT_STACK_PROFILING
+    StackProfiler::getInstance()->sample();
+#endif
+
+    return true;
+}
+#endif
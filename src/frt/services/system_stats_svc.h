@@ -0,0 +1,57 @@
+#ifndef __SYSTEM_STATS_SVC_H__
+#define __SYSTEM_STATS_SVC_H__
+
+#include <Arduino.h>
+
+#include "frt/frt.h"
+#include "frt/task.h"
+#include "frt/log.h"
+#include "frt/pubsub.h"
+
+#define RECORD_TASK_STATS "task_stats"
+#define SYSTEM_STATS_INTERVAL_MS 1000
+#define SYSTEM_STATS_MAX_TASKS 24
+
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+
+namespace frt
+{
+    /**
+     *  Samples the run-time counters of all tasks registered in the Manager
+     *  and publishes their CPU share over the last interval together with
+     *  their stack high-water marks as msgs::TaskStats on RECORD_TASK_STATS.
+     *  A task is reported from its second sample on, and only the first
+     *  FRT_MAX_TASK_STATS tasks are. Subscribe with a queue size of 1, e.g.
+     *  pubsub::subscribe<msgs::TaskStats, 1>(RECORD_TASK_STATS).
+     */
+    class SystemStatsService : public frt::Task<SystemStatsService, 2048>
+    {
+    public:
+        SystemStatsService(unsigned int interval_ms = SYSTEM_STATS_INTERVAL_MS);
+        virtual ~SystemStatsService() {}
+        bool run() override;
+
+    private:
+        struct Sample
+        {
+            TaskHandle_t handle;
+            uint32_t run_time;
+        };
+
+        frt::Publisher<msgs::TaskStats, 1> *_pub;
+        TaskStatus_t _status[SYSTEM_STATS_MAX_TASKS];
+        Sample _last[FRT_MAX_TASK_STATS];
+        size_t _last_count;
+        uint32_t _last_total;
+        TickType_t _last_wake;
+        unsigned int _interval_ms;
+
+        bool lastRunTime(TaskHandle_t handle, uint32_t &run_time) const;
+    };
+}
+
+#else
+#warning "System stats service needs configUSE_TRACE_FACILITY and configGENERATE_RUN_TIME_STATS"
+#endif
+
+#endif // __SYSTEM_STATS_SVC_H__
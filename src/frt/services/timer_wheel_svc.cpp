@@ -0,0 +1,221 @@
+#include "timer_wheel_svc.h"
+#include "frt/periodic_task.h"
+
+using namespace frt;
+
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_RANGE (1UL << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS))
+
+TimerWheelService::TimerWheelService(unsigned int resolution_ms) : _expired(nullptr),
+                                                                   _count(0),
+                                                                   _now(0),
+                                                                   _resolution(max(1U, (unsigned int)pdMS_TO_TICKS(resolution_ms))),
+                                                                   _last_wake(0)
+{
+    for (auto &level : _wheel)
+    {
+        for (WheelTimer *&slot : level)
+        {
+            slot = nullptr;
+        }
+    }
+}
+
+void TimerWheelService::schedule(WheelTimer *timer, unsigned int delay_ms, unsigned int period_ms)
+{
+    LockGuard lock(_mutex);
+
+    timer->_period = period_ms > 0 ? toTicks(period_ms) : 0;
+    arm(timer, toTicks(delay_ms));
+}
+
+void TimerWheelService::reschedule(WheelTimer *timer, unsigned int delay_ms)
+{
+    LockGuard lock(_mutex);
+    arm(timer, toTicks(delay_ms));
+}
+
+bool TimerWheelService::cancel(WheelTimer *timer)
+{
+    LockGuard lock(_mutex);
+
+    if (timer->_prev == nullptr)
+        return false;
+
+    unlink(timer);
+    _count--;
+
+    return true;
+}
+
+bool TimerWheelService::isScheduled(const WheelTimer *timer)
+{
+    LockGuard lock(_mutex);
+    return timer->_prev != nullptr;
+}
+
+size_t TimerWheelService::scheduled()
+{
+    LockGuard lock(_mutex);
+    return _count;
+}
+
+uint32_t TimerWheelService::toTicks(unsigned int msecs) const
+{
+    // Round up to whole slots, the expiry is accurate to one resolution
+    const TickType_t ticks = pdMS_TO_TICKS(msecs);
+    return max(1U, (unsigned int)((ticks + _resolution - 1) / _resolution));
+}
+
+void TimerWheelService::arm(WheelTimer *timer, uint32_t ticks)
+{
+    if (timer->_prev != nullptr)
+        unlink(timer);
+    else
+        _count++;
+
+    timer->_expires = _now + ticks;
+    insert(timer);
+
+    // Wake the wheel if it was idle
+    if (_count == 1 && isRunning())
+        post();
+}
+
+void TimerWheelService::insert(WheelTimer *timer)
+{
+    const uint32_t delta = timer->_expires - _now;
+    uint32_t expires = timer->_expires;
+    size_t level = 0;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1UL << (TIMER_WHEEL_SLOT_BITS * (level + 1))))
+    {
+        level++;
+    }
+
+    // Beyond the range of the wheel, park it in the last slot and reinsert it when that is cascaded
+    if (delta >= TIMER_WHEEL_RANGE)
+        expires = _now + TIMER_WHEEL_RANGE - 1;
+
+    WheelTimer *&head = _wheel[level][(expires >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK];
+
+    timer->_next = head;
+    if (head != nullptr)
+        head->_prev = &timer->_next;
+
+    head = timer;
+    timer->_prev = &head;
+}
+
+void TimerWheelService::unlink(WheelTimer *timer)
+{
+    *timer->_prev = timer->_next;
+    if (timer->_next != nullptr)
+        timer->_next->_prev = timer->_prev;
+
+    timer->_next = nullptr;
+    timer->_prev = nullptr;
+}
+
+void TimerWheelService::cascade(size_t level)
+{
+    WheelTimer *&head = _wheel[level][(_now >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK];
+
+    // Detach the slot first, a parked timer may go back into it
+    WheelTimer *pending = head;
+    head = nullptr;
+
+    if (pending != nullptr)
+        pending->_prev = &pending;
+
+    while (pending != nullptr)
+    {
+        WheelTimer *timer = pending;
+        unlink(timer);
+        insert(timer);
+    }
+}
+
+void TimerWheelService::advance()
+{
+    _now++;
+
+    // Whenever a level wraps, the current slot of the level above is distributed to the lower levels
+    for (size_t level = 1; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        if (((_now >> (TIMER_WHEEL_SLOT_BITS * (level - 1))) & TIMER_WHEEL_SLOT_MASK) != 0)
+            break;
+
+        cascade(level);
+    }
+
+    WheelTimer *&head = _wheel[0][_now & TIMER_WHEEL_SLOT_MASK];
+
+    while (head != nullptr)
+    {
+        WheelTimer *timer = head;
+        unlink(timer);
+
+        timer->_next = _expired;
+        if (_expired != nullptr)
+            _expired->_prev = &timer->_next;
+
+        _expired = timer;
+        timer->_prev = &_expired;
+    }
+}
+
+void TimerWheelService::expire()
+{
+    while (_expired != nullptr)
+    {
+        WheelTimer *timer = _expired;
+        unlink(timer);
+
+        // Rearm before the callback, so it can cancel or reschedule its own timer
+        if (timer->_period > 0)
+        {
+            timer->_expires = _now + timer->_period;
+            insert(timer);
+        }
+        else
+        {
+            _count--;
+        }
+
+        // A default constructed timer has no callback until setCallback()
+        if (!timer->_fn)
+            continue;
+
+        _mutex.unlock();
+        timer->_fn();
+        _mutex.lock();
+    }
+}
+
+bool TimerWheelService::run()
+{
+    _mutex.lock();
+
+    if (_count == 0)
+    {
+        _mutex.unlock();
+
+        // Nothing scheduled, sleep until the next timer is armed
+        wait();
+        _last_wake = xTaskGetTickCount();
+
+        return true;
+    }
+
+    _mutex.unlock();
+
+    FRT_DELAY_UNTIL(&_last_wake, _resolution);
+
+    LockGuard lock(_mutex);
+
+    advance();
+    expire();
+
+    return true;
+}
@@ -0,0 +1,136 @@
+#ifndef __TIMER_WHEEL_SVC_H__
+#define __TIMER_WHEEL_SVC_H__
+
+#include <Arduino.h>
+
+#include "frt/frt.h"
+#include "frt/task.h"
+#include "frt/mutex.h"
+#include "frt/inline_function.h"
+
+#define TIMER_WHEEL_RESOLUTION_MS 10
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1U << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_CALLBACK_CAPACITY 16
+
+static_assert(TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS < 32, "Timer wheel range exceeds 32 bits");
+
+namespace frt
+{
+    class TimerWheelService;
+
+    /**
+     *  Lightweight timer for the TimerWheelService. The timer is an
+     *  intrusive list node owned by the caller, so scheduling it neither
+     *  allocates nor creates a FreeRTOS timer.
+     */
+    class WheelTimer final
+    {
+    public:
+        WheelTimer() : _next(nullptr),
+                       _prev(nullptr),
+                       _expires(0),
+                       _period(0)
+        {
+        }
+
+        template <typename F>
+        explicit WheelTimer(F &&fn) : _next(nullptr),
+                                      _prev(nullptr),
+                                      _expires(0),
+                                      _period(0),
+                                      _fn(std::forward<F>(fn))
+        {
+        }
+
+        explicit WheelTimer(const WheelTimer &other) = delete;
+        WheelTimer &operator=(const WheelTimer &other) = delete;
+
+        // Replace the callback, only while the timer is not scheduled
+        template <typename F>
+        void setCallback(F &&fn)
+        {
+            _fn.assign(std::forward<F>(fn));
+        }
+
+    private:
+        friend class TimerWheelService;
+
+        WheelTimer *_next;
+        WheelTimer **_prev;
+        uint32_t _expires;
+        uint32_t _period;
+        InlineFunction<TIMER_WHEEL_CALLBACK_CAPACITY> _fn;
+    };
+
+    /**
+     *  Runs any number of WheelTimers on a single task.
+     *  The timers are kept in a hierarchical timing wheel of
+     *  TIMER_WHEEL_LEVELS levels with TIMER_WHEEL_SLOTS slots each. Level 0
+     *  holds the timers due within the next TIMER_WHEEL_SLOTS ticks of
+     *  resolution_ms, every further level covers TIMER_WHEEL_SLOTS times the
+     *  range of the one below and is cascaded down when the level below
+     *  wraps. Scheduling and cancelling is O(1), independent of the number of
+     *  timers, and no command goes through the timer daemon queue.
+     *
+     *  Callbacks run on the wheel task without the wheel locked, so they may
+     *  schedule or cancel timers, including their own. They must not block.
+     *  All methods lock the wheel with a mutex and are not callable from an
+     *  ISR. From an interrupt, notify a task that schedules the timer, or
+     *  use a Timer, whose start(), stop() and reset() work from an ISR.
+     *
+     *      TimerWheelService *wheel = new TimerWheelService();
+     *      wheel->start(configMAX_PRIORITIES - 2, "timer_wheel");
+     *
+     *      static WheelTimer timeout([] { connection.close(); });
+     *      wheel->schedule(&timeout, 5000);
+     *      ...
+     *      wheel->reschedule(&timeout, 5000); // on every received packet
+     */
+    class TimerWheelService : public frt::Task<TimerWheelService, 2048>
+    {
+    public:
+        TimerWheelService(unsigned int resolution_ms = TIMER_WHEEL_RESOLUTION_MS);
+        virtual ~TimerWheelService() {}
+        bool run() override;
+
+        /**
+         *  Schedule a timer, replacing a pending expiry. Not callable from an ISR.
+         *
+         *  @param delay_ms Time until the first expiry, rounded up to the resolution.
+         *  @param period_ms Time between further expiries, 0 for a one shot timer.
+         */
+        void schedule(WheelTimer *timer, unsigned int delay_ms, unsigned int period_ms = 0);
+
+        // Move the next expiry of a timer, keeping its period. Not callable from an ISR.
+        void reschedule(WheelTimer *timer, unsigned int delay_ms);
+
+        // Remove a timer from the wheel. Returns false if it was not scheduled. Not callable from an ISR.
+        bool cancel(WheelTimer *timer);
+
+        bool isScheduled(const WheelTimer *timer);
+
+        // Number of scheduled timers
+        size_t scheduled();
+
+    private:
+        uint32_t toTicks(unsigned int msecs) const;
+        void arm(WheelTimer *timer, uint32_t ticks);
+        void insert(WheelTimer *timer);
+        void unlink(WheelTimer *timer);
+        void cascade(size_t level);
+        void advance();
+        void expire();
+
+        Mutex _mutex;
+        WheelTimer *_wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+        WheelTimer *_expired;
+        size_t _count;
+        uint32_t _now;
+        TickType_t _resolution;
+        TickType_t _last_wake;
+    };
+}
+
+#endif // __TIMER_WHEEL_SVC_H__
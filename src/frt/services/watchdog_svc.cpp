@@ -0,0 +1,223 @@
+#include "watchdog_svc.h"
+#include "frt/periodic_task.h"
+
+#ifdef ESP32
+#include <esp_task_wdt.h>
+#endif
+
+using namespace frt;
+
+#ifdef ESP32
+static void feedTaskWatchdog()
+{
+    esp_task_wdt_reset();
+}
+#endif
+
+WatchdogService::WatchdogService(unsigned int resolution_ms) : _cursor(0),
+                                                               _unhealthy(0),
+                                                               _resolution(max(1U, (unsigned int)pdMS_TO_TICKS(resolution_ms))),
+                                                               _last_wake(0),
+#ifdef ESP32
+                                                               _feed(feedTaskWatchdog)
+#else
+                                                               _feed(nullptr)
+#endif
+{
+    _pub = pubsub::advertise<msgs::TaskFault, 4>(RECORD_TASK_FAULT);
+
+    for (Entry *&slot : _wheel)
+    {
+        slot = nullptr;
+    }
+
+    for (Entry &entry : _entries)
+    {
+        entry.task = nullptr;
+    }
+}
+
+void WatchdogService::init()
+{
+#ifdef ESP32
+    // The task watchdog only expects resets from tasks that are subscribed to it
+    if (_feed == feedTaskWatchdog)
+        esp_task_wdt_add(nullptr);
+#endif
+}
+
+bool WatchdogService::supervise(ITask *task, unsigned int period_ms, bool restart)
+{
+    LockGuard lock(_mutex);
+    Entry *entry = nullptr;
+
+    for (Entry &candidate : _entries)
+    {
+        if (candidate.task == nullptr)
+        {
+            entry = &candidate;
+            break;
+        }
+    }
+
+    if (entry == nullptr)
+        return false;
+
+    entry->task = task;
+    entry->period = max(1U, (unsigned int)pdMS_TO_TICKS(period_ms));
+    entry->misses = 0;
+    entry->restart = restart;
+    entry->failed = false;
+
+    // The period starts now, not at the last check-in of the task
+    task->checkIn();
+    schedule(entry, entry->period);
+
+    return true;
+}
+
+bool WatchdogService::unsupervise(ITask *task)
+{
+    LockGuard lock(_mutex);
+
+    for (Entry *&head : _wheel)
+    {
+        for (Entry **link = &head; *link != nullptr; link = &(*link)->next)
+        {
+            Entry *entry = *link;
+
+            if (entry->task != task)
+                continue;
+
+            *link = entry->next;
+
+            if (entry->failed)
+                _unhealthy--;
+
+            entry->task = nullptr;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WatchdogService::setFeedFunction(FeedFunction feed)
+{
+    LockGuard lock(_mutex);
+    _feed = feed;
+}
+
+bool WatchdogService::healthy()
+{
+    LockGuard lock(_mutex);
+    return _unhealthy == 0;
+}
+
+void WatchdogService::schedule(Entry *entry, TickType_t delay)
+{
+    // Round up, a task must never be checked before its deadline
+    const TickType_t slots = max(1U, (unsigned int)((delay + _resolution - 1) / _resolution));
+
+    entry->rounds = (slots - 1) / WATCHDOG_WHEEL_SLOTS;
+
+    const size_t slot = (_cursor + slots) % WATCHDOG_WHEEL_SLOTS;
+    entry->next = _wheel[slot];
+    _wheel[slot] = entry;
+}
+
+bool WatchdogService::expire(Entry *entry, TickType_t now, Fault &fault)
+{
+    const TickType_t silent = now - entry->task->lastCheckIn();
+
+    // A task that is not running cannot check in, it is checked again once started
+    if (silent < entry->period || *entry->task->handle() == nullptr)
+    {
+        if (entry->failed)
+        {
+            entry->failed = false;
+            _unhealthy--;
+        }
+
+        // Next deadline is one period after the last check-in
+        schedule(entry, silent < entry->period ? entry->period - silent : entry->period);
+        return false;
+    }
+
+    entry->misses++;
+
+    if (!entry->failed)
+    {
+        entry->failed = true;
+        _unhealthy++;
+    }
+
+    fault.task = entry->task;
+    fault.restart = entry->restart;
+    fault.msg.timestamp = now;
+    strncpy(fault.msg.name, entry->task->name(), sizeof(fault.msg.name) - 1);
+    fault.msg.name[sizeof(fault.msg.name) - 1] = '\0';
+    fault.msg.silent_ms = silent * portTICK_PERIOD_MS;
+    fault.msg.misses = entry->misses;
+    fault.msg.restarted = false;
+
+    schedule(entry, entry->period);
+    return true;
+}
+
+bool WatchdogService::run()
+{
+    if (_last_wake == 0)
+        _last_wake = xTaskGetTickCount();
+
+    FRT_DELAY_UNTIL(&_last_wake, _resolution);
+
+    Fault faults[WATCHDOG_MAX_TASKS];
+    size_t count = 0;
+
+    _mutex.lock();
+    const TickType_t now = xTaskGetTickCount();
+
+    _cursor = (_cursor + 1) % WATCHDOG_WHEEL_SLOTS;
+
+    // Detach the slot, entries that are not due yet go back into it
+    Entry *entry = _wheel[_cursor];
+    _wheel[_cursor] = nullptr;
+
+    while (entry != nullptr)
+    {
+        Entry *next = entry->next;
+
+        if (entry->rounds > 0)
+        {
+            entry->rounds--;
+            entry->next = _wheel[_cursor];
+            _wheel[_cursor] = entry;
+        }
+        else if (expire(entry, now, faults[count]))
+        {
+            count++;
+        }
+
+        entry = next;
+    }
+
+    if (_unhealthy == 0 && _feed != nullptr)
+        _feed();
+
+    _mutex.unlock();
+
+    // Restarting waits for the task and publishing must not stall the watchdog, so both run unlocked
+    for (size_t i = 0; i < count; i++)
+    {
+        Fault &fault = faults[i];
+
+        fault.msg.restarted = fault.restart && fault.task->restart(WATCHDOG_RESTART_TIMEOUT_MS);
+
+        FRT_LOG_ERROR("[ %s ] Missed check-in, silent for %u ms", fault.msg.name, fault.msg.silent_ms);
+
+        _pub->publish(fault.msg, 0);
+    }
+
+    return true;
+}
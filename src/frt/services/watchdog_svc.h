@@ -0,0 +1,105 @@
+#ifndef __WATCHDOG_SVC_H__
+#define __WATCHDOG_SVC_H__
+
+#include <Arduino.h>
+
+#include "frt/frt.h"
+#include "frt/task.h"
+#include "frt/log.h"
+#include "frt/pubsub.h"
+
+#define RECORD_TASK_FAULT "task_fault"
+#define WATCHDOG_RESOLUTION_MS 10
+#define WATCHDOG_WHEEL_SLOTS 32
+#define WATCHDOG_MAX_TASKS 16
+#define WATCHDOG_RESTART_TIMEOUT_MS 100
+
+namespace frt
+{
+    /**
+     *  Software watchdog for registered tasks.
+     *  Every supervised task has to check in at least once per period,
+     *  which Task does after each run(). The deadlines are kept in a timing
+     *  wheel with WATCHDOG_RESOLUTION_MS per slot, so each tick only looks at
+     *  the tasks that are due in this slot.
+     *
+     *  A missed check-in is published as msgs::TaskFault on RECORD_TASK_FAULT
+     *  and, if requested, the task is restarted. Tasks that are not running,
+     *  e.g. stopped on purpose, are neither reported nor restarted until they
+     *  are started again. The hardware watchdog is fed
+     *  only while all supervised tasks are healthy. On the ESP32 this is the
+     *  task watchdog by default, elsewhere pass a feed function.
+     *
+     *      WatchdogService *wdt = new WatchdogService();
+     *      wdt->supervise(pid_svc, 500, true);
+     *      wdt->start(configMAX_PRIORITIES - 1, "watchdog");
+     */
+    class WatchdogService : public frt::Task<WatchdogService, 2048>
+    {
+    public:
+        typedef void (*FeedFunction)();
+
+        WatchdogService(unsigned int resolution_ms = WATCHDOG_RESOLUTION_MS);
+        virtual ~WatchdogService() {}
+        void init() override;
+        bool run() override;
+
+        /**
+         *  Start supervising a task.
+         *
+         *  @param period_ms Maximum time between two check-ins.
+         *  @param restart Restart the task through stop()/start() on a missed check-in.
+         *  @return false if WATCHDOG_MAX_TASKS tasks are supervised already.
+         */
+        bool supervise(ITask *task, unsigned int period_ms, bool restart = false);
+
+        /**
+         *  Stop supervising a task. Has to be called before a supervised task
+         *  is destroyed.
+         *
+         *  @return false if the task was not supervised.
+         */
+        bool unsupervise(ITask *task);
+
+        // Function that feeds the hardware watchdog, nullptr disables feeding
+        void setFeedFunction(FeedFunction feed);
+
+        // True while no supervised task has missed its latest check-in
+        bool healthy();
+
+    private:
+        struct Entry
+        {
+            ITask *task; // nullptr if the entry is free
+            TickType_t period;
+            uint32_t rounds;
+            uint32_t misses;
+            bool restart;
+            bool failed;
+            Entry *next;
+        };
+
+        // Fault found under the lock, reported and handled after releasing it
+        struct Fault
+        {
+            ITask *task;
+            bool restart;
+            msgs::TaskFault msg;
+        };
+
+        void schedule(Entry *entry, TickType_t delay);
+        bool expire(Entry *entry, TickType_t now, Fault &fault);
+
+        frt::Publisher<msgs::TaskFault, 4> *_pub;
+        Mutex _mutex;
+        Entry _entries[WATCHDOG_MAX_TASKS];
+        Entry *_wheel[WATCHDOG_WHEEL_SLOTS];
+        size_t _cursor;
+        size_t _unhealthy;
+        TickType_t _resolution;
+        TickType_t _last_wake;
+        FeedFunction _feed;
+    };
+}
+
+#endif // __WATCHDOG_SVC_H__
@@ -0,0 +1,114 @@
+#include "stack_profiler.h"
+
+using namespace frt;
+
+StackProfiler *StackProfiler::instance{nullptr};
+Mutex StackProfiler::mutex;
+
+StackProfiler *StackProfiler::getInstance()
+{
+    LockGuard lock(mutex);
+
+    if (instance == nullptr)
+    {
+        instance = new StackProfiler();
+    }
+    return instance;
+}
+
+// Turn a task name into a valid macro name
+static void macroName(const char *name, char *macro)
+{
+    size_t len = strlen(name);
+    for (size_t c = 0; c <= len; c++)
+    {
+        char ch = name[c];
+        macro[c] = isalnum(ch) ? toupper(ch) : (ch == '\0' ? '\0' : '_');
+    }
+}
+
+StackProfiler::Entry *StackProfiler::find(const ITask *task)
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].task == task)
+            return &_entries[i];
+    }
+
+    return nullptr;
+}
+
+void StackProfiler::sample()
+{
+    LockGuard lock(mutex);
+
+    Manager::getInstance()->forEachTask(
+        [this](ITask *t)
+        {
+            // A task that exits meanwhile must not turn into a null handle, which means the calling task
+            const TaskHandle_t handle = *t->handle();
+            if (handle == nullptr)
+                return;
+
+            Entry *entry = find(t);
+
+            if (entry == nullptr)
+            {
+                if (_count >= FRT_STACK_PROFILER_MAX_TASKS)
+                    return;
+
+                entry = &_entries[_count++];
+                entry->task = t;
+                strncpy(entry->name, t->name(), sizeof(entry->name) - 1);
+                entry->name[sizeof(entry->name) - 1] = '\0';
+                entry->size = t->getStackSize();
+                entry->min_remaining = entry->size;
+            }
+
+            unsigned int remaining = uxTaskGetStackHighWaterMark(handle) * sizeof(StackType_t);
+            if (remaining < entry->min_remaining)
+                entry->min_remaining = remaining;
+        });
+
+    _samples++;
+}
+
+void StackProfiler::writeHeader(Print &out, unsigned int margin_percent)
+{
+    LockGuard lock(mutex);
+
+    const unsigned int minimum = configMINIMAL_STACK_SIZE * sizeof(StackType_t);
+
+    out.printf("// Generated by frt::StackProfiler from %lu samples with a %u%% margin\r\n", (unsigned long)_samples, margin_percent);
+    out.printf("#ifndef __FRT_STACK_SIZES_H__\r\n#define __FRT_STACK_SIZES_H__\r\n\r\n");
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        const Entry &entry = _entries[i];
+        const unsigned int peak = entry.size - entry.min_remaining;
+
+        unsigned int recommended = peak + (peak * margin_percent + 99) / 100;
+        recommended = ((recommended + FRT_STACK_GRANULARITY - 1) / FRT_STACK_GRANULARITY) * FRT_STACK_GRANULARITY;
+        if (recommended < minimum)
+            recommended = minimum;
+
+        char macro[configMAX_TASK_NAME_LEN];
+        macroName(entry.name, macro);
+
+        // Names that are empty or map to the same macro as an earlier task get the index appended
+        bool unique = macro[0] != '\0';
+        for (size_t j = 0; unique && j < i; j++)
+        {
+            char other[configMAX_TASK_NAME_LEN];
+            macroName(_entries[j].name, other);
+            unique = strcmp(macro, other) != 0;
+        }
+
+        if (unique)
+            out.printf("#define FRT_STACK_SIZE_%s %u // declared %u, peak %u\r\n", macro, recommended, entry.size, peak);
+        else
+            out.printf("#define FRT_STACK_SIZE_%s_%u %u // declared %u, peak %u\r\n", macro[0] != '\0' ? macro : "UNNAMED", (unsigned int)i, recommended, entry.size, peak);
+    }
+
+    out.printf("\r\n#endif // __FRT_STACK_SIZES_H__\r\n");
+}
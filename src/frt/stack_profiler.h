@@ -0,0 +1,70 @@
+#ifndef __FRT_STACK_PROFILER_H__
+#define __FRT_STACK_PROFILER_H__
+
+#include <Arduino.h>
+
+#include "mutex.h"
+#include "task.h"
+
+#define FRT_STACK_PROFILER_MAX_TASKS 16
+#define FRT_STACK_MARGIN_PERCENT 25
+#define FRT_STACK_GRANULARITY 64
+
+namespace frt
+{
+    /**
+     *  Tracks the stack high-water mark of every task registered in the
+     *  Manager. After a soak run writeHeader() prints a header with a
+     *  recommended stack size per task, e.g.
+     *
+     *      #define FRT_STACK_SIZE_PID_SVC 1344
+     *
+     *  which can be saved to the project and used as the STACK_SIZE_BYTES
+     *  template argument of the task. Tasks without a name, or whose names
+     *  map to the same macro, get their index appended. With FRT_STACK_PROFILING defined the
+     *  SystemStatsService samples automatically at every interval.
+     */
+    class StackProfiler
+    {
+    private:
+        struct Entry
+        {
+            const ITask *task;
+            char name[configMAX_TASK_NAME_LEN];
+            unsigned int size;
+            unsigned int min_remaining;
+        };
+
+        static StackProfiler *instance;
+        static Mutex mutex;
+
+        Entry _entries[FRT_STACK_PROFILER_MAX_TASKS];
+        size_t _count;
+        uint32_t _samples;
+
+        StackProfiler() : _count(0), _samples(0) {}
+
+        Entry *find(const ITask *task);
+
+    public:
+        StackProfiler(StackProfiler &other) = delete;
+        void operator=(const StackProfiler &) = delete;
+
+        static StackProfiler *getInstance();
+
+        // Record the current high-water mark of all registered tasks
+        void sample();
+
+        uint32_t samples() const { return _samples; }
+
+        /**
+         *  Print the recommended stack sizes as a C header.
+         *
+         *  @param out Stream the header is written to.
+         *  @param margin_percent Safety margin on top of the peak usage.
+         */
+        void writeHeader(Print &out, unsigned int margin_percent = FRT_STACK_MARGIN_PERCENT);
+    };
+}
+
+#endif // __FRT_STACK_PROFILER_H__
@@ -0,0 +1,289 @@
+#ifndef __FRT_SYNCHRONIZER_H__
+#define __FRT_SYNCHRONIZER_H__
+
+#include <functional>
+#include <tuple>
+
+#include "frt.h"
+#include "pubsub.h"
+
+#define FRT_SYNC_DEFAULT_DEPTH 4
+
+namespace frt
+{
+    namespace detail
+    {
+        template <size_t... I>
+        struct IndexSequence
+        {
+        };
+
+        template <size_t N, size_t... I>
+        struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...>
+        {
+        };
+
+        template <size_t... I>
+        struct MakeIndexSequence<0, I...> : IndexSequence<I...>
+        {
+        };
+
+        // Signed difference of two tick stamps, correct across a tick counter wrap
+        inline int32_t stampDiff(uint32_t a, uint32_t b)
+        {
+            return static_cast<int32_t>(a - b);
+        }
+
+        template <typename T, unsigned int N>
+        class Ring
+        {
+        public:
+            Ring() : _head(0), _count(0) {}
+
+            bool empty() const { return _count == 0; }
+            bool full() const { return _count == N; }
+            unsigned int size() const { return _count; }
+
+            const T &front() const { return _buf[_head]; }
+
+            // Push to the back. Returns false if the oldest element had to be dropped.
+            bool push(const T &item)
+            {
+                bool dropped = false;
+
+                if (full())
+                {
+                    pop();
+                    dropped = true;
+                }
+
+                _buf[(_head + _count) % N] = item;
+                _count++;
+
+                return !dropped;
+            }
+
+            void pop()
+            {
+                if (_count == 0)
+                    return;
+
+                _head = (_head + 1) % N;
+                _count--;
+            }
+
+        private:
+            T _buf[N];
+            unsigned int _head;
+            unsigned int _count;
+        };
+    }
+
+    /**
+     *  Approximate-time synchronizer for two or more subscriptions.
+     *
+     *  Every subscriber is added to a private queue set. Received messages are
+     *  buffered in a small ring per topic and matched by their
+     *  msgs::Message::timestamp. A tuple is delivered in one callback as soon as
+     *  the oldest buffered message of every topic lies within the slop window.
+     *  Messages that can no longer be part of any match are dropped.
+     *
+     *  Subscriber queues must be empty when handed to the synchronizer and must
+     *  not be read by anybody else afterwards.
+     *
+     *  @tparam DEPTH Number of messages buffered per topic.
+     *  @tparam SUBS Subscriber types, e.g. Subscriber<msgs::Temperature>.
+     */
+    template <unsigned int DEPTH, typename... SUBS>
+    class Synchronizer final
+    {
+        static_assert(sizeof...(SUBS) >= 2, "Synchronizer needs at least two subscriptions");
+        static_assert(DEPTH > 0, "Synchronizer depth must be greater than zero");
+
+    public:
+        typedef std::function<void(const typename SUBS::MessageType &...)> SynchronizerCallback;
+
+        Synchronizer(unsigned int slop_msecs, SUBS *...subs) : _subs(subs...),
+                                                               _slop(pdMS_TO_TICKS(slop_msecs)),
+                                                               _matched(0),
+                                                               _dropped(0)
+        {
+            _set = xQueueCreateSet(totalQueueSize<SUBS...>());
+            configASSERT(_set);
+            addToSet(Indices());
+        }
+
+        ~Synchronizer()
+        {
+            vQueueDelete(_set);
+        }
+
+        explicit Synchronizer(const Synchronizer &other) = delete;
+        Synchronizer &operator=(const Synchronizer &other) = delete;
+
+        void registerCallback(SynchronizerCallback cb)
+        {
+            _callback = cb;
+        }
+
+        /**
+         *  Wait for the next message on any topic, buffer it and deliver every
+         *  tuple that can be matched.
+         *
+         *  @param msecs How long to wait for a message.
+         *  @return Number of tuples delivered to the callback.
+         */
+        unsigned int spinOnce(unsigned int msecs = portMAX_DELAY / configTICK_RATE_HZ)
+        {
+            const TickType_t ticks = pdMS_TO_TICKS(msecs);
+            QueueSetMemberHandle_t member = xQueueSelectFromSet(_set, ticks);
+
+            if (member == nullptr)
+                return 0;
+
+            receive(member, Indices());
+
+            return match();
+        }
+
+        uint32_t matched() const { return _matched; }
+        uint32_t dropped() const { return _dropped; }
+
+    private:
+        typedef detail::MakeIndexSequence<sizeof...(SUBS)> Indices;
+
+        template <typename S>
+        static constexpr unsigned int totalQueueSize()
+        {
+            return S::queueSize();
+        }
+
+        template <typename S, typename NEXT, typename... REST>
+        static constexpr unsigned int totalQueueSize()
+        {
+            return S::queueSize() + totalQueueSize<NEXT, REST...>();
+        }
+
+        template <size_t... I>
+        void addToSet(detail::IndexSequence<I...>)
+        {
+            int unused[] = {0, (std::get<I>(_subs)->addToSet(_set), 0)...};
+            FRT_UNUSED(unused);
+        }
+
+        template <size_t... I>
+        void receive(QueueSetMemberHandle_t &member, detail::IndexSequence<I...>)
+        {
+            int unused[] = {0, (receiveOne<I>(member), 0)...};
+            FRT_UNUSED(unused);
+        }
+
+        template <size_t I>
+        void receiveOne(QueueSetMemberHandle_t &member)
+        {
+            if (!std::get<I>(_subs)->canReceive(member))
+                return;
+
+            typename std::tuple_element<I, MessageTuple>::type msg;
+            if (std::get<I>(_subs)->receive(msg))
+            {
+                if (!std::get<I>(_rings).push(msg))
+                    _dropped++;
+            }
+        }
+
+        template <size_t... I>
+        bool allAvailable(detail::IndexSequence<I...>) const
+        {
+            bool available[] = {!std::get<I>(_rings).empty()...};
+
+            for (bool a : available)
+            {
+                if (!a)
+                    return false;
+            }
+
+            return true;
+        }
+
+        template <size_t... I>
+        void popOldest(detail::IndexSequence<I...>)
+        {
+            uint32_t stamps[] = {std::get<I>(_rings).front().timestamp...};
+            size_t oldest = 0;
+
+            for (size_t i = 1; i < sizeof...(I); i++)
+            {
+                if (detail::stampDiff(stamps[i], stamps[oldest]) < 0)
+                    oldest = i;
+            }
+
+            int unused[] = {0, (I == oldest ? (std::get<I>(_rings).pop(), 0) : 0)...};
+            FRT_UNUSED(unused);
+        }
+
+        template <size_t... I>
+        bool withinSlop(detail::IndexSequence<I...>) const
+        {
+            uint32_t stamps[] = {std::get<I>(_rings).front().timestamp...};
+            uint32_t oldest = stamps[0];
+            uint32_t newest = stamps[0];
+
+            for (size_t i = 1; i < sizeof...(I); i++)
+            {
+                if (detail::stampDiff(stamps[i], oldest) < 0)
+                    oldest = stamps[i];
+                if (detail::stampDiff(stamps[i], newest) > 0)
+                    newest = stamps[i];
+            }
+
+            return (newest - oldest) <= _slop;
+        }
+
+        template <size_t... I>
+        void deliver(detail::IndexSequence<I...>)
+        {
+            if (_callback)
+                _callback(std::get<I>(_rings).front()...);
+
+            int unused[] = {0, (std::get<I>(_rings).pop(), 0)...};
+            FRT_UNUSED(unused);
+        }
+
+        unsigned int match()
+        {
+            unsigned int delivered = 0;
+
+            while (allAvailable(Indices()))
+            {
+                if (withinSlop(Indices()))
+                {
+                    deliver(Indices());
+                    _matched++;
+                    delivered++;
+                }
+                else
+                {
+                    // Messages arrive in timestamp order per topic, so the oldest
+                    // head can never be matched by anything still to come
+                    popOldest(Indices());
+                    _dropped++;
+                }
+            }
+
+            return delivered;
+        }
+
+        typedef std::tuple<typename SUBS::MessageType...> MessageTuple;
+
+        std::tuple<SUBS *...> _subs;
+        std::tuple<detail::Ring<typename SUBS::MessageType, DEPTH>...> _rings;
+        SynchronizerCallback _callback;
+        QueueSetHandle_t _set;
+        TickType_t _slop;
+        uint32_t _matched;
+        uint32_t _dropped;
+    };
+}
+
+#endif // __FRT_SYNCHRONIZER_H__
@@ -4,25 +4,127 @@
 #include "frt.h"
 #include "log.h"
 #include "manager.h"
+#include "notify.h"
+
+#ifdef FRT_TASK_RUN_STATS
+#include "msgs.h"
+#include "pubsub.h"
+#endif
 
 #define FLAG_TASK 0x00000001
 
+#define FRT_RUN_STATS_BUCKETS 32
+#define RECORD_DEADLINE_MISS "deadline_miss"
+#define FRT_SNAPSHOT_MAX_TASKS 24
+
+#if !defined(INCLUDE_xTaskAbortDelay) || (INCLUDE_xTaskAbortDelay != 1)
+#warning "INCLUDE_xTaskAbortDelay is not enabled, Task::stop() cannot wake a blocked task and waits until its run() returns"
+#endif
+
 namespace frt
 {
+#ifdef FRT_TASK_RUN_STATS
+    /**
+     *  Execution time of the run() calls of a task in CPU cycles.
+     *  Bucket n of the histogram counts the calls that took between 2^n
+     *  and 2^(n+1) - 1 cycles.
+     */
+    struct RunStats
+    {
+        uint32_t count;
+        uint32_t min_cycles;
+        uint32_t max_cycles;
+        uint64_t total_cycles;
+        uint32_t deadline_misses;
+        uint32_t histogram[FRT_RUN_STATS_BUCKETS];
+
+        uint32_t avgCycles() const
+        {
+            return count > 0 ? static_cast<uint32_t>(total_cycles / count) : 0;
+        }
+
+        void reset()
+        {
+            memset(this, 0, sizeof(RunStats));
+            min_cycles = UINT32_MAX;
+        }
+
+        void record(uint32_t cycles)
+        {
+            count++;
+            total_cycles += cycles;
+
+            if (cycles < min_cycles)
+                min_cycles = cycles;
+
+            if (cycles > max_cycles)
+                max_cycles = cycles;
+
+            histogram[31 - __builtin_clz(cycles | 1U)]++;
+        }
+    };
+
+    namespace detail
+    {
+        // Templates so that pubsub.h, which includes this header indirectly, is only needed on instantiation
+        template <typename M>
+        Publisher<M, 4> *deadlineMissPublisher()
+        {
+            static Publisher<M, 4> *pub = Manager::getInstance()->template aquirePublisher<M, 4>(RECORD_DEADLINE_MISS);
+            return pub;
+        }
+
+        template <typename M>
+        void publishDeadlineMiss(const M &miss)
+        {
+            deadlineMissPublisher<M>()->publish(miss);
+        }
+    }
+#endif
+
     class ITask
     {
     protected:
         TaskHandle_t m_handle;
         const char *m_name;
+        volatile TickType_t m_last_checkin;
 
     public:
         ITask() : m_handle(nullptr),
-                  m_name("")
+                  m_name(""),
+                  m_last_checkin(0)
         {
         }
 
         virtual ~ITask() {}
         virtual void gracefulShutdown(){};
+        virtual unsigned int getStackSize() const = 0;
+        virtual unsigned int getRemainingStackSize() const = 0;
+        virtual bool requestStop() = 0;
+        virtual bool join(unsigned int msecs = portMAX_DELAY) = 0;
+
+        /**
+         *  Stop the task and start it again with the same parameters.
+         *
+         *  @param msecs Maximum time to wait for the task to exit.
+         *  @return false if the task did not exit in time and was left as is.
+         */
+        virtual bool restart(unsigned int msecs) = 0;
+
+        /**
+         *  Report liveness to the WatchdogService. Called by the task after
+         *  every run(), a task that blocks longer inside run() can call it
+         *  in between.
+         */
+        void checkIn()
+        {
+            m_last_checkin = xTaskGetTickCount();
+        }
+
+        TickType_t lastCheckIn() const
+        {
+            return m_last_checkin;
+        }
 
         const TaskHandle_t *handle() const
         {
@@ -33,6 +135,17 @@ namespace frt
         {
             return m_name;
         }
+
+        /**
+         *  Typed notification channel of this task, see notify.h.
+         *
+         *      auto samples = task.channel<frt::CountingChannel<1>>();
+         */
+        template <typename Channel>
+        Channel channel() const
+        {
+            return Channel(&m_handle);
+        }
     };
     // This should work in theory. However vertain FreeRTOS implementation do not define enough memory as configMINIMAL_STACK_SIZE, 1024 is a good guess!
     // template <typename T, unsigned int STACK_SIZE_BYTES = configMINIMAL_STACK_SIZE * sizeof(StackType_t)>
@@ -41,27 +154,78 @@ namespace frt
     {
     public:
         Task() : m_running(false),
-                 m_do_stop(false)
+                 m_do_stop(false),
+                 m_priority(0),
+                 m_core(FRT_NO_AFFINITY),
+                 m_exited(nullptr)
         {
+#ifdef FRT_TASK_RUN_STATS
+            m_run_stats.reset();
+            m_deadline_cycles = 0;
+            m_deadline_us = 0;
+#endif
         }
 
         ~Task()
         {
             stop();
+
+            // The task may also have left its loop on its own
+            reap();
         }
 
         explicit Task(const Task &other) = delete;
         Task &operator=(const Task &other) = delete;
 
-        TaskHandle_t start(unsigned char priority = 0, const char *name = "")
+        /**
+         *  Create the FreeRTOS task and register it in the Manager.
+         *
+         *  @param priority Task priority, clamped to configMAX_PRIORITIES - 1.
+         *  @param name Task name, also used as key in the Manager.
+         *  @param core Core the task is pinned to on SMP targets, FRT_NO_AFFINITY
+         *         lets the scheduler decide. Ignored on single-core targets.
+         */
+        TaskHandle_t start(unsigned char priority = 0, const char *name = "", BaseType_t core = FRT_NO_AFFINITY)
         {
             this->m_name = name;
 
+            // Drop a join signal left over from a stop that timed out
+            m_join.tryWait();
+            reap();
+            checkIn();
+
             if (priority >= configMAX_PRIORITIES)
             {
                 priority = configMAX_PRIORITIES - 1;
             }
 
+            m_priority = priority;
+            m_core = core;
+
+#if defined(ESP32)
+            const BaseType_t affinity = (FRT_NUM_CORES > 1 && core >= 0 && core < FRT_NUM_CORES) ? core : tskNO_AFFINITY;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+            m_handle = xTaskCreateStaticPinnedToCore(
+                entryPoint,
+                name,
+                STACK_SIZE_BYTES / sizeof(StackType_t),
+                this,
+                priority,
+                m_stack,
+                &m_state,
+                affinity);
+#else
+            xTaskCreatePinnedToCore(
+                entryPoint,
+                name,
+                STACK_SIZE_BYTES / sizeof(StackType_t),
+                this,
+                priority,
+                &m_handle,
+                affinity);
+#endif
+#else
+            FRT_UNUSED(core);
 #if configSUPPORT_STATIC_ALLOCATION > 0
             m_handle = xTaskCreateStatic(
                 entryPoint,
@@ -80,20 +244,114 @@ namespace frt
                 priority,
                 &m_handle);
 #endif
-            Manager::getInstance()->addTask(this, name);
+#endif
+            Manager::getInstance()->addTask(this);
             return m_handle;
         }
 
-        bool stop()
+        /**
+         *  Stop the task and wait until it has exited.
+         *
+         *  @param msecs Maximum time to wait for the task to exit.
+         *  @return false if the task was not started or did not exit in time.
+         */
+        bool stop(unsigned int msecs = portMAX_DELAY)
         {
-            Manager::getInstance()->removeTask(m_name);
-            return stop(false);
+            if (!requestStop())
+                return false;
+
+            return join(msecs);
         }
 
+        bool restart(unsigned int msecs) override
+        {
+            // A task that already left its loop only needs to be started
+            if (m_handle != nullptr && !stop(msecs))
+                return false;
+
+            return start(m_priority, m_name, m_core) != nullptr;
+        }
+
+        /**
+         *  Ask the task to stop from the idle hook. The idle task must never
+         *  block, so this neither takes the Manager lock nor waits: the task
+         *  deregisters itself when it exits. Poll isRunning() on later calls
+         *  of the hook to see it gone.
+         *
+         *  @return false if the task was not started.
+         */
         bool stopFromIdleTask()
         {
-            Manager::getInstance()->removeTask(m_name);
-            return stop(true);
+            return signalStop();
+        }
+
+        /**
+         *  Ask the task to stop without waiting for it. A blocking wait of the
+         *  task is aborted once, so it sees the request right away instead of
+         *  at the end of its timeout. A wait the task enters after the request
+         *  is not aborted and runs its course. To shut down several tasks, call
+         *  requestStop() on all of them before joining any, so that their
+         *  exits overlap, as stopAll() does.
+         *
+         *  @return false if the task was not started.
+         */
+        bool requestStop() override
+        {
+            Manager::getInstance()->removeTask(this);
+
+            return signalStop();
+        }
+
+        // Stop a group of tasks, requesting all first so they shut down in parallel
+        template <size_t N>
+        static void stopAll(T (&tasks)[N])
+        {
+            bool requested[N];
+
+            for (size_t i = 0; i < N; i++)
+            {
+                requested[i] = tasks[i].requestStop();
+            }
+
+            for (size_t i = 0; i < N; i++)
+            {
+                if (requested[i])
+                    tasks[i].join();
+            }
+        }
+
+        // Name of task index of a group, the prefix is cut so that the index always fits
+        static void indexedName(char (&name)[configMAX_TASK_NAME_LEN], const char *prefix, unsigned int index)
+        {
+            snprintf(name, sizeof(name), "%.*s%u", configMAX_TASK_NAME_LEN - 4, prefix, index);
+        }
+
+        /**
+         *  Wait until the task has exited after requestStop(). The task
+         *  signals its exit, so the caller wakes up right away. On return the
+         *  kernel no longer uses the stack and TCB of the task, so the object
+         *  may be destroyed or started again. Must not be called by the task
+         *  itself.
+         *
+         *  @return false if the task did not exit in time.
+         */
+        bool join(unsigned int msecs = portMAX_DELAY) override
+        {
+            if (FRT_IS_ISR() || xTaskGetCurrentTaskHandle() == m_handle)
+                return false;
+
+            FRT_CRITICAL_ENTER();
+            const bool exited = m_handle == nullptr;
+            FRT_CRITICAL_EXIT();
+
+            if (exited)
+                m_join.tryWait();
+            else if (!(msecs == portMAX_DELAY ? m_join.wait() : m_join.wait(msecs)))
+                return false;
+
+            reap();
+
+            return true;
         }
 
         bool isRunning() const
@@ -107,16 +365,54 @@ namespace frt
             return res;
         }
 
+        unsigned int getStackSize() const override
+        {
+            return STACK_SIZE_BYTES;
+        }
+
         unsigned int getUsedStackSize() const
         {
             return STACK_SIZE_BYTES - getRemainingStackSize();
         }
 
-        unsigned int getRemainingStackSize() const
+        unsigned int getRemainingStackSize() const override
         {
             return uxTaskGetStackHighWaterMark(m_handle) * sizeof(StackType_t);
         }
 
+#ifdef FRT_TASK_RUN_STATS
+        /**
+         *  Statistics of the wall-clock duration of every run() call. Time the
+         *  task spends blocked or preempted inside run() is included, so for a
+         *  task that sleeps in run() this is closer to its period than to its
+         *  execution time. On a dual-core ESP32 the task has to be pinned, the
+         *  cycle counters of the cores are not in sync.
+         */
+        const RunStats &runStats() const
+        {
+            return m_run_stats;
+        }
+
+        void resetRunStats()
+        {
+            m_run_stats.reset();
+        }
+
+        /**
+         *  Declare a deadline for a single run() call. Every call that takes
+         *  longer is counted and published as msgs::DeadlineMiss on
+         *  RECORD_DEADLINE_MISS.
+         *
+         *  @param usecs Deadline in microseconds, 0 disables the check.
+         */
+        void setDeadline(uint32_t usecs)
+        {
+            detail::deadlineMissPublisher<msgs::DeadlineMiss>();
+            m_deadline_us = usecs;
+            m_deadline_cycles = detail::microsToCycles(usecs);
+        }
+#endif
+
         void post()
         {
             if (FRT_IS_ISR())
@@ -200,33 +496,72 @@ namespace frt
         }
 
     private:
-        bool stop(bool from_idle_task)
+        /**
+         *  Wait until the kernel is done with the task that exited last. With
+         *  static allocation its stack and TCB live in this object, and the
+         *  task still runs on them between its exit signal and vTaskDelete().
+         */
+        void reap()
         {
-            if (!m_handle)
+#if configSUPPORT_STATIC_ALLOCATION > 0
+            FRT_CRITICAL_ENTER();
+            const TaskHandle_t handle = m_exited;
+            FRT_CRITICAL_EXIT();
+
+            if (handle == nullptr)
+                return;
+
+#if (INCLUDE_eTaskGetState == 1)
+            while (eTaskGetState(handle) != eDeleted)
             {
-                return false;
+                vTaskDelay(1);
             }
 
+            // On SMP the deleted task may still be switching out on the other core
+            if (FRT_NUM_CORES > 1)
+                vTaskDelay(1);
+#else
+#warning "INCLUDE_eTaskGetState is not enabled, Task::join() waits two ticks for the task to be deleted"
+            vTaskDelay(2);
+#endif
+
             FRT_CRITICAL_ENTER();
-            m_do_stop = true;
+            m_exited = nullptr;
+            FRT_CRITICAL_EXIT();
+#endif
+        }
+
+        // Set the stop flag and wake the task once, never blocks
+        bool signalStop()
+        {
+            bool started = false;
 
-            while (m_running)
+            FRT_CRITICAL_ENTER();
+            if (m_handle)
             {
-                FRT_CRITICAL_EXIT();
-                if (!from_idle_task)
-                {
-                    vTaskDelay(1);
-                }
-                else
-                {
-                    taskYIELD();
-                }
-                FRT_CRITICAL_ENTER();
+                m_do_stop = true;
+                started = true;
             }
-
             FRT_CRITICAL_EXIT();
 
-            return true;
+            if (started)
+                interrupt();
+
+            return started;
+        }
+
+        // Wake the task up if it is blocked, the blocking call returns with a failure
+        void interrupt()
+        {
+#if (INCLUDE_xTaskAbortDelay == 1)
+            // While the scheduler is suspended the task cannot exit, so its handle stays valid
+            vTaskSuspendAll();
+            const TaskHandle_t handle = m_handle;
+
+            if (handle)
+                xTaskAbortDelay(handle);
+            xTaskResumeAll();
+#endif
         }
 
         static void entryPoint(void *data)
@@ -244,8 +579,14 @@ namespace frt
 
             static_cast<T *>(self)->init();
 
-            while (!do_stop && static_cast<T *>(self)->run())
+#ifdef FRT_TASK_RUN_STATS
+            detail::enableCycleCounter();
+#endif
+
+            while (!do_stop && self->measuredRun())
             {
+                self->checkIn();
+
                 {
                     FRT_CRITICAL_ENTER();
                     do_stop = self->m_do_stop;
@@ -253,102 +594,343 @@ namespace frt
                 }
             }
 
+            // Also for a stop from the idle task, which must not take the Manager lock
+            Manager::getInstance()->removeTask(self);
+
+            TaskHandle_t handle_copy;
+
             {
                 FRT_CRITICAL_ENTER();
                 self->m_do_stop = false;
                 self->m_running = false;
+                handle_copy = self->m_handle;
+                self->m_handle = nullptr;
+                self->m_exited = handle_copy;
                 FRT_CRITICAL_EXIT();
             }
 
-            const TaskHandle_t handle_copy = self->m_handle;
-            self->m_handle = nullptr;
+            self->m_join.post();
 
             vTaskDelete(handle_copy);
         }
 
+        bool measuredRun()
+        {
+#ifdef FRT_TASK_RUN_STATS
+            const uint32_t start = detail::cycleCount();
+            const bool res = static_cast<T *>(this)->run();
+            const uint32_t cycles = detail::cycleCount() - start;
+
+            m_run_stats.record(cycles);
+
+            if (m_deadline_cycles > 0 && cycles > m_deadline_cycles)
+            {
+                m_run_stats.deadline_misses++;
+
+                msgs::DeadlineMiss miss;
+                miss.timestamp = xTaskGetTickCount();
+                strncpy(miss.name, m_name, sizeof(miss.name) - 1);
+                miss.name[sizeof(miss.name) - 1] = '\0';
+                miss.elapsed_us = detail::cyclesToMicros(cycles);
+                miss.deadline_us = m_deadline_us;
+                detail::publishDeadlineMiss(miss);
+            }
+
+            return res;
+#else
+            return static_cast<T *>(this)->run();
+#endif
+        }
+
         volatile bool m_running;
         volatile bool m_do_stop;
+        Semaphore m_join;
+        unsigned char m_priority;
+        BaseType_t m_core;
+        TaskHandle_t m_exited;
+#ifdef FRT_TASK_RUN_STATS
+        RunStats m_run_stats;
+        uint32_t m_deadline_cycles;
+        uint32_t m_deadline_us;
+#endif
 #if configSUPPORT_STATIC_ALLOCATION > 0
         StackType_t m_stack[STACK_SIZE_BYTES / sizeof(StackType_t)];
         StaticTask_t m_state;
 #endif
     };
 
+    /**
+     *  Spreads tasks over the cores by their declared load.
+     *  Every call to place() returns the core with the least load so far and
+     *  adds the given load to it. Placing the heaviest tasks first gives the
+     *  best balance.
+     *
+     *      CoreBalancer balancer;
+     *      output_svc->start(5, "output", balancer.place(40));
+     *      pid_svc->start(4, "pid", balancer.place(25));
+     */
+    class CoreBalancer final
+    {
+    public:
+        CoreBalancer()
+        {
+            for (unsigned int &load : m_load)
+                load = 0;
+        }
+
+        // Reserve load on a core, e.g. for WiFi on core 0 of the ESP32
+        void reserve(BaseType_t core, unsigned int load)
+        {
+            if (core >= 0 && core < FRT_NUM_CORES)
+                m_load[core] += load;
+        }
+
+        BaseType_t place(unsigned int load)
+        {
+            if (FRT_NUM_CORES == 1)
+                return FRT_NO_AFFINITY;
+
+            BaseType_t best = 0;
+            for (BaseType_t core = 1; core < FRT_NUM_CORES; core++)
+            {
+                if (m_load[core] < m_load[best])
+                    best = core;
+            }
+
+            m_load[best] += load;
+            return best;
+        }
+
+        unsigned int load(BaseType_t core) const
+        {
+            return (core >= 0 && core < FRT_NUM_CORES) ? m_load[core] : 0;
+        }
+
+    private:
+        unsigned int m_load[FRT_NUM_CORES];
+    };
+
     namespace task
     {
-        inline void suspendOtherTasks()
+        /**
+         *  Consistent list of the registered tasks, taken under the Manager
+         *  lock and sorted by descending priority. The calling task is never
+         *  part of it. On the ESP32 the Arduino loopTask is included as well.
+         */
+        class Snapshot final
         {
-            Manager *man = Manager::getInstance();
-            const char *name = pcTaskGetName(NULL);
+        public:
+            struct Entry
+            {
+                ITask *task; /**< nullptr for the loopTask */
+                TaskHandle_t handle;
+                UBaseType_t priority;
+            };
 
-            for (auto t : *man->getTasks())
+            Snapshot() : _count(0),
+                         _dropped(0)
             {
-                if (strcmp(t.second->name(), name) != 0)
-                {
-                    Serial.printf("Task [%s] will be suspended!\r\n", t.second->name());
-                    t.second->gracefulShutdown();
-                    vTaskSuspend(*t.second->handle());
-                }
             }
 
+            void take()
+            {
+                const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+                _count = 0;
+                _dropped = 0;
+
+                Manager::getInstance()->forEachTask(
+                    [this, self](ITask *t)
+                    {
+                        const TaskHandle_t handle = *t->handle();
+
+                        if (handle != nullptr && handle != self)
+                            add(t, handle);
+                    });
+
 #ifdef ESP32
-            TaskHandle_t loopHandle = xTaskGetHandle("loopTask");
+                const TaskHandle_t loopHandle = xTaskGetHandle("loopTask");
+
+                if (loopHandle != nullptr && loopHandle != self)
+                    add(nullptr, loopHandle);
+#endif
+            }
+
+            size_t count() const { return _count; }
+
+            // Tasks that did not fit into FRT_SNAPSHOT_MAX_TASKS
+            size_t dropped() const { return _dropped; }
 
-            if (loopHandle != NULL)
+            const Entry &operator[](size_t i) const { return _entries[i]; }
+            const Entry *begin() const { return _entries; }
+            const Entry *end() const { return _entries + _count; }
+
+        private:
+            void add(ITask *t, TaskHandle_t handle)
             {
-                vTaskSuspend(loopHandle);
-                Serial.printf("Task [looptask] will be suspended!\r\n");
+                if (_count >= FRT_SNAPSHOT_MAX_TASKS)
+                {
+                    _dropped++;
+                    return;
+                }
+
+                const UBaseType_t priority = uxTaskPriorityGet(handle);
+
+                // Insertion sort, highest priority first
+                size_t i = _count++;
+                while (i > 0 && _entries[i - 1].priority < priority)
+                {
+                    _entries[i] = _entries[i - 1];
+                    i--;
+                }
+
+                _entries[i].task = t;
+                _entries[i].handle = handle;
+                _entries[i].priority = priority;
             }
-#endif
-        }
 
-        inline void resumeOtherTasks()
+            Entry _entries[FRT_SNAPSHOT_MAX_TASKS];
+            size_t _count;
+            size_t _dropped;
+        };
+
+        /**
+         *  Pauses all other tasks, e.g. around an OTA write or a flash erase.
+         *  The tasks are suspended in priority order within one
+         *  scheduler-suspended section, so none of them runs while the others
+         *  are being suspended. On a dual-core ESP32 this only holds for the
+         *  calling core, tasks on the other core stop as they are reached.
+         *
+         *      frt::task::Quiesce quiesce;
+         *      quiesce.pause();
+         *      eraseFlash();
+         *      quiesce.resume();
+         */
+        class Quiesce final
         {
-            Manager *man = Manager::getInstance();
-            const char *name = pcTaskGetName(NULL);
+        public:
+            Quiesce() : _latency_us(0),
+                        _paused_at(0),
+                        _paused(false)
+            {
+            }
+
+            /**
+             *  @return Time from the call until all tasks were suspended in microseconds.
+             */
+            uint32_t pause()
+            {
+                const uint32_t start = micros();
+
+                if (_paused)
+                    return 0;
+
+                _snapshot.take();
+
+                // The registry stays locked, so a task found in it cannot exit while being suspended
+                Manager::getInstance()->withTasks(
+                    [this](const std::unordered_map<size_t, ITask *> &tasks)
+                    {
+                        vTaskSuspendAll();
+                        for (size_t i = 0; i < _snapshot.count(); i++)
+                        {
+                            const Snapshot::Entry &entry = _snapshot[i];
+
+                            // Skip tasks that exited or restarted after the snapshot was taken
+                            _suspended[i] = entry.task == nullptr || registered(tasks, entry);
+                            if (_suspended[i])
+                                vTaskSuspend(entry.handle);
+                        }
+                        xTaskResumeAll();
+                    });
+
+                _paused = true;
+                _paused_at = micros();
+                _latency_us = _paused_at - start;
+
+                return _latency_us;
+            }
 
-            for (auto t : *man->getTasks())
+            /**
+             *  @return How long the tasks were paused in microseconds.
+             */
+            uint32_t resume()
             {
-                if (strcmp(t.second->name(), name) != 0)
+                if (!_paused)
+                    return 0;
+
+                vTaskSuspendAll();
+                for (size_t i = 0; i < _snapshot.count(); i++)
                 {
-                    vTaskResume(*t.second->handle());
+                    if (_suspended[i])
+                        vTaskResume(_snapshot[i].handle);
                 }
+                xTaskResumeAll();
+
+                _paused = false;
+
+                return micros() - _paused_at;
             }
 
-#ifdef ESP32
-            TaskHandle_t loopHandle = xTaskGetHandle("loopTask");
+            bool paused() const { return _paused; }
+
+            // Pause latency of the last pause() in microseconds
+            uint32_t latency() const { return _latency_us; }
 
-            if (loopHandle != NULL)
+            const Snapshot &snapshot() const { return _snapshot; }
+
+        private:
+            static bool registered(const std::unordered_map<size_t, ITask *> &tasks, const Snapshot::Entry &entry)
             {
-                vTaskResume(loopHandle);
-                Serial.printf("Task [looptask] will be resumed!\r\n");
+                auto it = tasks.find(reinterpret_cast<size_t>(entry.task));
+
+                return it != tasks.end() && *it->second->handle() == entry.handle;
+            }
+
+            Snapshot _snapshot;
+            bool _suspended[FRT_SNAPSHOT_MAX_TASKS];
+            uint32_t _latency_us;
+            uint32_t _paused_at;
+            bool _paused;
+        };
+
+        inline void suspendOtherTasks()
+        {
+            Snapshot snapshot;
+            snapshot.take();
+
+            for (const Snapshot::Entry &entry : snapshot)
+            {
+                if (entry.task != nullptr)
+                    entry.task->gracefulShutdown();
+
+                vTaskSuspend(entry.handle);
             }
-#endif
         }
 
-        inline void deleteOtherTasks()
+        inline void resumeOtherTasks()
         {
-            Manager *man = Manager::getInstance();
-            const char *name = pcTaskGetName(NULL);
+            Snapshot snapshot;
+            snapshot.take();
 
-            for (auto t : *man->getTasks())
+            for (const Snapshot::Entry &entry : snapshot)
             {
-                if (strcmp(t.second->name(), name) != 0)
-                {
-                    t.second->gracefulShutdown();
-                    vTaskDelete(*t.second->handle());
-                }
+                vTaskResume(entry.handle);
             }
+        }
 
-#ifdef ESP32
-            TaskHandle_t loopHandle = xTaskGetHandle("loopTask");
+        inline void deleteOtherTasks()
+        {
+            Snapshot snapshot;
+            snapshot.take();
 
-            if (loopHandle != NULL)
+            for (const Snapshot::Entry &entry : snapshot)
             {
-                vTaskDelete(loopHandle);
-                Serial.printf("Task [looptask] will be deleted!\r\n");
+                if (entry.task != nullptr)
+                    entry.task->gracefulShutdown();
+
+                vTaskDelete(entry.handle);
             }
-#endif
         }
     }
 }
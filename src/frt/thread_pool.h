@@ -0,0 +1,638 @@
+#ifndef __FRT_THREAD_POOL_H__
+#define __FRT_THREAD_POOL_H__
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+#include "frt.h"
+#include "task.h"
+#include "queue.h"
+#include "event_group.h"
+#include "inline_function.h"
+
+#define FRT_POOL_JOBS 32
+#define FRT_POOL_DEQUE_SIZE 16
+#define FRT_POOL_JOB_CAPACITY 32
+#define FRT_POOL_RESULT_SIZE 8
+#define FRT_POOL_WAIT_MS 10
+
+namespace frt
+{
+    namespace detail
+    {
+        /**
+         *  Chase-Lev work-stealing deque with a fixed capacity.
+         *  Only the owning worker may push() and pop() at the bottom, any
+         *  other task may steal() from the top.
+         */
+        template <typename T, unsigned int N>
+        class WorkStealingDeque final
+        {
+            static_assert((N & (N - 1)) == 0, "Deque size has to be a power of two");
+
+        public:
+            WorkStealingDeque() : _top(0), _bottom(0)
+            {
+                for (std::atomic<T> &item : _buf)
+                    item.store(T(), std::memory_order_relaxed);
+            }
+
+            explicit WorkStealingDeque(const WorkStealingDeque &other) = delete;
+            WorkStealingDeque &operator=(const WorkStealingDeque &other) = delete;
+
+            bool push(T item)
+            {
+                const int32_t b = _bottom.load(std::memory_order_relaxed);
+                const int32_t t = _top.load(std::memory_order_acquire);
+
+                if (b - t >= static_cast<int32_t>(N))
+                    return false;
+
+                _buf[b & (N - 1)].store(item, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                _bottom.store(b + 1, std::memory_order_relaxed);
+
+                return true;
+            }
+
+            bool pop(T &item)
+            {
+                const int32_t b = _bottom.load(std::memory_order_relaxed) - 1;
+                _bottom.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int32_t t = _top.load(std::memory_order_relaxed);
+
+                if (t > b)
+                {
+                    _bottom.store(b + 1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                item = _buf[b & (N - 1)].load(std::memory_order_relaxed);
+
+                if (t == b)
+                {
+                    // Last item, race against thieves for it
+                    const bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                    _bottom.store(b + 1, std::memory_order_relaxed);
+                    return won;
+                }
+
+                return true;
+            }
+
+            bool steal(T &item)
+            {
+                int32_t t = _top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const int32_t b = _bottom.load(std::memory_order_acquire);
+
+                if (t >= b)
+                    return false;
+
+                item = _buf[t & (N - 1)].load(std::memory_order_relaxed);
+
+                return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<int32_t> _top;
+            std::atomic<int32_t> _bottom;
+            std::atomic<T> _buf[N];
+        };
+
+        struct PoolJob
+        {
+            InlineFunction<FRT_POOL_JOB_CAPACITY> fn;
+            std::atomic<bool> done;
+            std::atomic<uint8_t> refs;
+            void (*destroyResult)(void *);
+            alignas(std::max_align_t) unsigned char result[FRT_POOL_RESULT_SIZE];
+        };
+
+        /**
+         *  Part of the thread pool that does not depend on the number of
+         *  workers: job slots, the injection queue for jobs submitted from
+         *  outside the pool and completion signalling.
+         */
+        class PoolBase
+        {
+        public:
+            PoolBase() : _waiters(0)
+            {
+                for (PoolJob &job : _jobs)
+                {
+                    job.done.store(false, std::memory_order_relaxed);
+                    job.refs.store(0, std::memory_order_relaxed);
+                    job.destroyResult = nullptr;
+                }
+            }
+
+            virtual ~PoolBase() {}
+
+            // Run one pending job on the calling task. Used by waiters to help instead of blocking.
+            virtual bool runOne() = 0;
+
+            void release(PoolJob *job)
+            {
+                uint8_t refs = job->refs.load(std::memory_order_acquire);
+
+                // Only acquire() raises the count from 0, so the last holder is alone with the slot
+                while (refs > 1)
+                {
+                    if (job->refs.compare_exchange_weak(refs, refs - 1, std::memory_order_acq_rel))
+                        return;
+                }
+
+                if (job->destroyResult != nullptr)
+                {
+                    job->destroyResult(job->result);
+                    job->destroyResult = nullptr;
+                }
+
+                // Publish the slot as free only after the cleanup
+                job->refs.store(0, std::memory_order_release);
+            }
+
+            void waitFor(PoolJob *job)
+            {
+                _waiters.fetch_add(1, std::memory_order_seq_cst);
+
+                while (!job->done.load(std::memory_order_seq_cst))
+                {
+                    if (runOne())
+                        continue;
+
+                    _done.clearBits(DONE_BIT);
+
+                    if (job->done.load(std::memory_order_seq_cst))
+                        break;
+
+                    _done.waitBits(DONE_BIT, false, false, FRT_POOL_WAIT_MS);
+                }
+
+                _waiters.fetch_sub(1, std::memory_order_seq_cst);
+            }
+
+        protected:
+            static const EventBits_t DONE_BIT = (1 << 0);
+
+            PoolJob *acquire(uint8_t refs)
+            {
+                for (PoolJob &job : _jobs)
+                {
+                    uint8_t expected = 0;
+                    if (job.refs.compare_exchange_strong(expected, refs, std::memory_order_acq_rel))
+                    {
+                        job.done.store(false, std::memory_order_relaxed);
+                        return &job;
+                    }
+                }
+
+                return nullptr;
+            }
+
+            void execute(PoolJob *job)
+            {
+                job->fn();
+                job->fn.reset();
+                job->done.store(true, std::memory_order_seq_cst);
+
+                if (_waiters.load(std::memory_order_seq_cst) > 0)
+                    _done.setBits(DONE_BIT);
+
+                release(job);
+            }
+
+            PoolJob _jobs[FRT_POOL_JOBS];
+            Queue<PoolJob *, FRT_POOL_JOBS> _injected;
+            EventGroup _done;
+            std::atomic<uint32_t> _waiters;
+        };
+    }
+
+    /**
+     *  Handle to the result of a job submitted to a ThreadPool.
+     *  Waiting tasks run other pending jobs of the pool before they block.
+     */
+    template <typename R>
+    class Future final
+    {
+    public:
+        Future() : _pool(nullptr), _job(nullptr), _inline(false) {}
+
+        Future(Future &&other) : _pool(other._pool),
+                                 _job(other._job),
+                                 _inline(other._inline)
+        {
+            if (_inline)
+                new (_value) R(std::move(*other.value()));
+
+            other._pool = nullptr;
+            other._job = nullptr;
+            other.clearInline();
+        }
+
+        ~Future()
+        {
+            if (_job != nullptr)
+                _pool->release(_job);
+
+            clearInline();
+        }
+
+        explicit Future(const Future &other) = delete;
+        Future &operator=(const Future &other) = delete;
+
+        bool valid() const { return _job != nullptr || _inline; }
+
+        bool ready() const
+        {
+            return _inline || (_job != nullptr && _job->done.load(std::memory_order_acquire));
+        }
+
+        void wait()
+        {
+            if (_job != nullptr)
+                _pool->waitFor(_job);
+        }
+
+        // Only on a valid() future
+        R get()
+        {
+            assert(valid());
+            wait();
+
+            if (_inline)
+                return *value();
+
+            return *reinterpret_cast<R *>(_job->result);
+        }
+
+    private:
+        template <unsigned int N, unsigned int S>
+        friend class ThreadPool;
+
+        Future(detail::PoolBase *pool, detail::PoolJob *job) : _pool(pool), _job(job), _inline(false) {}
+
+        // Result of a job that had to run on the submitting task because the pool was full
+        explicit Future(R &&result) : _pool(nullptr), _job(nullptr), _inline(true)
+        {
+            new (_value) R(std::move(result));
+        }
+
+        R *value() { return reinterpret_cast<R *>(_value); }
+
+        void clearInline()
+        {
+            if (_inline)
+                value()->~R();
+
+            _inline = false;
+        }
+
+        detail::PoolBase *_pool;
+        detail::PoolJob *_job;
+        bool _inline;
+        alignas(R) unsigned char _value[sizeof(R)];
+    };
+
+    template <>
+    class Future<void> final
+    {
+    public:
+        Future() : _pool(nullptr), _job(nullptr) {}
+
+        Future(Future &&other) : _pool(other._pool), _job(other._job)
+        {
+            other._pool = nullptr;
+            other._job = nullptr;
+        }
+
+        ~Future()
+        {
+            if (_job != nullptr)
+                _pool->release(_job);
+        }
+
+        explicit Future(const Future &other) = delete;
+        Future &operator=(const Future &other) = delete;
+
+        bool ready() const
+        {
+            return _job == nullptr || _job->done.load(std::memory_order_acquire);
+        }
+
+        void wait()
+        {
+            if (_job != nullptr)
+                _pool->waitFor(_job);
+        }
+
+        void get()
+        {
+            wait();
+        }
+
+    private:
+        template <unsigned int N, unsigned int S>
+        friend class ThreadPool;
+
+        Future(detail::PoolBase *pool, detail::PoolJob *job) : _pool(pool), _job(job) {}
+
+        detail::PoolBase *_pool;
+        detail::PoolJob *_job;
+    };
+
+    /**
+     *  Fixed-size pool of worker tasks with one work-stealing deque each.
+     *  Jobs submitted by a worker go to its own deque, jobs from any other
+     *  task go through a shared injection queue. Idle workers steal from the
+     *  others and sleep on their task notification when there is nothing to
+     *  do. Job slots are static, a job that finds no free slot runs on the
+     *  submitting task instead.
+     *
+     *  @tparam N_WORKERS Number of worker tasks, spread over all cores.
+     *  @tparam STACK_SIZE_BYTES Stack size of every worker.
+     */
+    template <unsigned int N_WORKERS, unsigned int STACK_SIZE_BYTES = 2048>
+    class ThreadPool final : public detail::PoolBase
+    {
+        static_assert(N_WORKERS > 0 && N_WORKERS <= 32, "A pool needs between 1 and 32 workers");
+
+    public:
+        ThreadPool() : _idle(0)
+        {
+            for (unsigned int i = 0; i < N_WORKERS; i++)
+            {
+                _workers[i].m_pool = this;
+                _workers[i].m_index = i;
+            }
+        }
+
+        explicit ThreadPool(const ThreadPool &other) = delete;
+        ThreadPool &operator=(const ThreadPool &other) = delete;
+
+        /**
+         *  Start all workers. Worker i is pinned to core i % FRT_NUM_CORES.
+         *
+         *  @param priority Priority of the worker tasks.
+         *  @param prefix Worker names are the prefix followed by the index.
+         */
+        void start(unsigned char priority = 1, const char *prefix = "pool")
+        {
+            for (unsigned int i = 0; i < N_WORKERS; i++)
+            {
+                Worker::indexedName(_names[i], prefix, i);
+                _workers[i].start(priority, _names[i], FRT_NUM_CORES > 1 ? static_cast<BaseType_t>(i % FRT_NUM_CORES) : FRT_NO_AFFINITY);
+            }
+        }
+
+        void stop()
+        {
+            Worker::stopAll(_workers);
+        }
+
+        /**
+         *  Run a callable on the pool.
+         *
+         *  @return Future for the result of the callable.
+         */
+        template <typename F>
+        Future<typename std::decay<decltype(std::declval<F &>()())>::type> submit(F &&fn)
+        {
+            typedef typename std::decay<decltype(std::declval<F &>()())>::type R;
+            return submit<R>(std::forward<F>(fn), std::is_void<R>());
+        }
+
+        /**
+         *  Call fn(i) for every i in [begin, end) and return when all calls
+         *  are done. The range is cut into chunks of at least grain indices
+         *  which are spread over the workers, the calling task works on the
+         *  range as well.
+         */
+        template <typename F>
+        void parallel_for(size_t begin, size_t end, F fn, size_t grain = 1)
+        {
+            if (begin >= end)
+                return;
+
+            if (grain == 0)
+                grain = 1;
+
+            const size_t count = end - begin;
+            size_t chunks = (count + grain - 1) / grain;
+            if (chunks > (N_WORKERS + 1) * 2)
+                chunks = (N_WORKERS + 1) * 2;
+
+            const size_t chunk = (count + chunks - 1) / chunks;
+            detail::PoolJob *jobs[(N_WORKERS + 1) * 2];
+            size_t submitted = 0;
+
+            // Queue all chunks but the first, which the caller runs itself
+            for (size_t b = begin + chunk; b < end; b += chunk)
+            {
+                const size_t e = (end - b) > chunk ? b + chunk : end;
+                detail::PoolJob *job = acquire(1);
+
+                if (job == nullptr)
+                {
+                    for (size_t i = b; i < e; i++)
+                        fn(i);
+                    continue;
+                }
+
+                job->fn.assign(
+                    [&fn, b, e]()
+                    {
+                        for (size_t i = b; i < e; i++)
+                            fn(i);
+                    });
+
+                // Keep a reference so that the completion can be waited for
+                job->refs.fetch_add(1, std::memory_order_relaxed);
+                jobs[submitted++] = job;
+                enqueue(job);
+            }
+
+            const size_t first_end = (end - begin) > chunk ? begin + chunk : end;
+            for (size_t i = begin; i < first_end; i++)
+                fn(i);
+
+            for (size_t i = 0; i < submitted; i++)
+            {
+                waitFor(jobs[i]);
+                release(jobs[i]);
+            }
+        }
+
+        bool runOne() override
+        {
+            detail::PoolJob *job;
+
+            if (!take(current(), job))
+                return false;
+
+            execute(job);
+            return true;
+        }
+
+    private:
+        class Worker final : public Task<Worker, STACK_SIZE_BYTES>
+        {
+        public:
+            bool run() override
+            {
+                return m_pool->work(m_index);
+            }
+
+            ThreadPool *m_pool;
+            unsigned int m_index;
+        };
+
+        template <typename R, typename F>
+        Future<void> submit(F &&fn, std::true_type)
+        {
+            detail::PoolJob *job = acquire(2);
+
+            if (job == nullptr)
+            {
+                fn();
+                return Future<void>();
+            }
+
+            job->fn.assign(std::forward<F>(fn));
+            enqueue(job);
+
+            return Future<void>(this, job);
+        }
+
+        template <typename R, typename F>
+        Future<R> submit(F &&fn, std::false_type)
+        {
+            static_assert(sizeof(R) <= FRT_POOL_RESULT_SIZE, "Result does not fit into a job slot, raise FRT_POOL_RESULT_SIZE");
+            static_assert(alignof(R) <= alignof(std::max_align_t), "Result is over-aligned");
+
+            detail::PoolJob *job = acquire(2);
+
+            if (job == nullptr)
+                return Future<R>(fn());
+
+            job->destroyResult = &destroyResult<R>;
+            job->fn.assign(
+                [fn, job]() mutable
+                {
+                    new (job->result) R(fn());
+                });
+            enqueue(job);
+
+            return Future<R>(this, job);
+        }
+
+        template <typename R>
+        static void destroyResult(void *result)
+        {
+            static_cast<R *>(result)->~R();
+        }
+
+        // Index of the calling worker, N_WORKERS for any other task
+        unsigned int current() const
+        {
+            const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+            for (unsigned int i = 0; i < N_WORKERS; i++)
+            {
+                if (*_workers[i].handle() == self)
+                    return i;
+            }
+
+            return N_WORKERS;
+        }
+
+        void enqueue(detail::PoolJob *job)
+        {
+            const unsigned int self = current();
+
+            if (!(self < N_WORKERS && _deques[self].push(job)) && !_injected.push(job, 0))
+            {
+                // No room anywhere, run it right here
+                execute(job);
+                return;
+            }
+
+            wakeOne();
+        }
+
+        bool take(unsigned int self, detail::PoolJob *&job)
+        {
+            if (self < N_WORKERS && _deques[self].pop(job))
+                return true;
+
+            if (_injected.tryPop(job))
+                return true;
+
+            for (unsigned int i = 1; i <= N_WORKERS; i++)
+            {
+                const unsigned int victim = (self + i) % N_WORKERS;
+
+                if (victim != self && _deques[victim].steal(job))
+                    return true;
+            }
+
+            return false;
+        }
+
+        void wakeOne()
+        {
+            uint32_t idle = _idle.load(std::memory_order_seq_cst);
+
+            // Claim an idle worker so that back-to-back jobs wake different workers
+            while (idle != 0)
+            {
+                const unsigned int worker = __builtin_ctz(idle);
+
+                if (_idle.compare_exchange_weak(idle, idle & ~(1UL << worker), std::memory_order_seq_cst))
+                {
+                    xTaskNotifyGive(*_workers[worker].handle());
+                    return;
+                }
+            }
+        }
+
+        bool work(unsigned int self)
+        {
+            detail::PoolJob *job;
+
+            if (take(self, job))
+            {
+                execute(job);
+                return true;
+            }
+
+            // Announce idleness before the last look, so a concurrent enqueue either
+            // sees this worker as idle or its job is found here
+            const uint32_t bit = 1UL << self;
+            _idle.fetch_or(bit, std::memory_order_seq_cst);
+
+            if (take(self, job))
+            {
+                _idle.fetch_and(~bit, std::memory_order_seq_cst);
+                execute(job);
+                return true;
+            }
+
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            _idle.fetch_and(~bit, std::memory_order_seq_cst);
+
+            return true;
+        }
+
+        Worker _workers[N_WORKERS];
+        detail::WorkStealingDeque<detail::PoolJob *, FRT_POOL_DEQUE_SIZE> _deques[N_WORKERS];
+        char _names[N_WORKERS][configMAX_TASK_NAME_LEN];
+        std::atomic<uint32_t> _idle;
+    };
+}
+
+#endif // __FRT_THREAD_POOL_H__
@@ -2,14 +2,59 @@
 #define __FRT_TIMER_H__
 
 #include <functional>
+#include <string.h>
 #include <type_traits>
 
 #include "frt.h"
 
 #define portZERO_DELAY pdMS_TO_TICKS(0)
+#define FRT_TIMER_COALESCE_MAX 16
 
 namespace frt
 {
+#ifdef FRT_TIMER_STATS
+    /**
+     *  Expiry latency and callback duration of timers. The latency is the
+     *  number of ticks between the scheduled expiry and the start of the
+     *  callback, it grows when the timer daemon is busy or preempted.
+     */
+    struct TimerStats
+    {
+        uint32_t count;
+        uint32_t late_count;
+        uint32_t max_late_ticks;
+        uint64_t total_late_ticks;
+        uint32_t max_cycles;
+        uint64_t total_cycles;
+
+        uint32_t avgCycles() const
+        {
+            return count > 0 ? static_cast<uint32_t>(total_cycles / count) : 0;
+        }
+
+        void reset()
+        {
+            memset(this, 0, sizeof(TimerStats));
+        }
+
+        void record(TickType_t late_ticks, uint32_t cycles)
+        {
+            count++;
+            total_late_ticks += late_ticks;
+            total_cycles += cycles;
+
+            if (late_ticks > 0)
+                late_count++;
+
+            if (late_ticks > max_late_ticks)
+                max_late_ticks = late_ticks;
+
+            if (cycles > max_cycles)
+                max_cycles = cycles;
+        }
+    };
+#endif
+
     class Timer
     {
     public:
@@ -46,6 +91,10 @@ namespace frt
                                   TimerCallbackFunctionAdapter);
 #endif
             assert(handle != nullptr);
+            initSlack(PeriodInTicks, Periodic);
+#ifdef FRT_TIMER_STATS
+            initStats();
+#endif
         }
 
         /**
@@ -78,6 +127,10 @@ namespace frt
                                   TimerCallbackFunctionAdapter);
 #endif
             assert(handle != nullptr);
+            initSlack(PeriodInTicks, Periodic);
+#ifdef FRT_TIMER_STATS
+            initStats();
+#endif
         }
 
         /**
@@ -85,6 +138,7 @@ namespace frt
          */
         virtual ~Timer()
         {
+            registerSlack(0);
             xTimerDelete(handle, portMAX_DELAY);
         }
 
@@ -108,6 +162,9 @@ namespace frt
          */
         bool start(TickType_t CmdTimeout = portMAX_DELAY)
         {
+            if (slack > 0)
+                return startCoalesced(CmdTimeout);
+
             bool success = false;
             if (FRT_IS_ISR())
             {
@@ -135,6 +192,8 @@ namespace frt
          */
         bool stop(TickType_t CmdTimeout = portMAX_DELAY)
         {
+            wakePending = false;
+
             bool success = false;
             if (FRT_IS_ISR())
             {
@@ -162,6 +221,9 @@ namespace frt
          */
         bool reset(TickType_t CmdTimeout = portMAX_DELAY)
         {
+            if (slack > 0)
+                return startCoalesced(CmdTimeout);
+
             bool success = false;
             if (FRT_IS_ISR())
             {
@@ -191,23 +253,120 @@ namespace frt
         bool setPeriod(TickType_t NewPeriod,
                        TickType_t CmdTimeout = portMAX_DELAY)
         {
-            bool success = false;
-            if (FRT_IS_ISR())
-            {
-                BaseType_t taskWoken = pdFALSE;
-                success = xTimerChangePeriodFromISR(handle, NewPeriod, &taskWoken);
-                
-                if (success)
-                    detail::yieldFromIsr(taskWoken);
-            }
-            else
+            period = NewPeriod;
+
+            if (slack > 0)
+                return startCoalesced(CmdTimeout);
+
+            return changePeriod(NewPeriod, CmdTimeout);
+        }
+
+        /**
+         *  Switch between a periodic and a one shot timer.
+         *  Takes effect the next time the timer expires or is started.
+         *
+         *  @param Periodic true if the timer expires every period.
+         *         false if this is a one shot timer.
+         */
+        void setPeriodic(bool Periodic)
+        {
+            autoReload = Periodic;
+            vTimerSetReloadMode(handle, Periodic ? pdTRUE : pdFALSE);
+        }
+
+        /**
+         *  Allow every expiry of the timer to be delayed by up to Slack
+         *  ticks, so it can share a wakeup with other timers that have a
+         *  slack. An expiry is moved to the earliest pending wakeup of such a
+         *  timer within its window, otherwise to the coarsest power of two
+         *  tick boundary in the window, where unrelated timers tend to meet.
+         *  The period of a periodic timer is kept, the slack does not add up.
+         *  Takes effect with the next start(), reset() or expiry.
+         *
+         *  @param Slack Allowed delay in ticks, 0 for exact expiries.
+         *  @return false if FRT_TIMER_COALESCE_MAX timers have a slack already.
+         */
+        bool setSlack(TickType_t Slack)
+        {
+            const TickType_t previous = slack;
+
+            if (!registerSlack(Slack))
+                return false;
+
+            // Coalesced expiries leave their own delay as the period of the FreeRTOS timer
+            if (previous > 0 && Slack == 0 && xTimerGetPeriod(handle) != period)
             {
-                success = xTimerChangePeriod(handle, NewPeriod, CmdTimeout);
+                const bool active = isActive();
+
+                changePeriod(period, portMAX_DELAY);
+                if (!active)
+                    stop();
             }
 
-            return success;
+            return true;
+        }
+
+        TickType_t getSlack() const
+        {
+            return slack;
+        }
+
+        // Expiries that joined the pending wakeup of another timer instead of waking the CPU on their own
+        static uint32_t wakeupsSaved()
+        {
+            return coalescer().saved;
+        }
+
+        // Expiries of timers with a slack
+        static uint32_t coalescedExpiries()
+        {
+            return coalescer().expiries;
         }
 
+#ifdef FRT_TIMER_STATS
+        /**
+         *  Statistics of all expiries of this timer. On a dual-core ESP32 the
+         *  timer daemon has to be pinned, the cycle counters of the cores are
+         *  not in sync.
+         */
+        const TimerStats &stats() const
+        {
+            return timerStats;
+        }
+
+        void resetStats()
+        {
+            timerStats.reset();
+        }
+
+        // Statistics of all timer callbacks since the last resetDaemonStats()
+        static const TimerStats &daemonStats()
+        {
+            return daemon().stats;
+        }
+
+        /**
+         *  Share of the time since the last resetDaemonStats() that the timer
+         *  daemon spent in callbacks of frt::Timer, in per mille.
+         */
+        static uint32_t daemonLoad()
+        {
+            const TickType_t elapsed = xTaskGetTickCount() - daemon().since;
+            const uint64_t busy_us = daemon().stats.total_cycles / max(1U, (unsigned int)detail::microsToCycles(1));
+
+            if (elapsed == 0)
+                return 0;
+
+            return static_cast<uint32_t>(busy_us / (static_cast<uint64_t>(elapsed) * portTICK_PERIOD_MS));
+        }
+
+        static void resetDaemonStats()
+        {
+            daemon().stats.reset();
+            daemon().since = xTaskGetTickCount();
+        }
+#endif
+
 #if (INCLUDE_xTimerGetTimerDaemonTaskHandle == 1)
         /**
          *  If you need it, obtain the task handle of the FreeRTOS
@@ -251,6 +410,194 @@ namespace frt
 #if configSUPPORT_STATIC_ALLOCATION > 0
         StaticTimer_t buffer;
 #endif
+        TickType_t period;
+        TickType_t slack;
+        TickType_t nominal;
+        TickType_t wake;
+        bool autoReload;
+        volatile bool wakePending;
+
+        struct Coalescer
+        {
+            Timer *timers[FRT_TIMER_COALESCE_MAX];
+            uint32_t saved;
+            uint32_t expiries;
+        };
+
+        static Coalescer &coalescer()
+        {
+            static Coalescer instance = {};
+            return instance;
+        }
+
+        bool registerSlack(TickType_t Slack)
+        {
+            bool success = true;
+
+            FRT_CRITICAL_ENTER();
+            Timer **slot = nullptr;
+
+            for (Timer *&entry : coalescer().timers)
+            {
+                if (entry == this || (slot == nullptr && entry == nullptr))
+                    slot = &entry;
+
+                if (entry == this)
+                    break;
+            }
+
+            if (Slack == 0 && slot != nullptr && *slot == this)
+                *slot = nullptr;
+            else if (Slack > 0 && slot != nullptr)
+                *slot = this;
+            else if (Slack > 0)
+                success = false;
+
+            if (success)
+            {
+                slack = Slack;
+                wakePending = false;
+            }
+            FRT_CRITICAL_EXIT();
+
+            return success;
+        }
+
+        void initSlack(TickType_t PeriodInTicks, bool Periodic)
+        {
+            period = PeriodInTicks;
+            slack = 0;
+            nominal = 0;
+            wake = 0;
+            autoReload = Periodic;
+            wakePending = false;
+        }
+
+        bool changePeriod(TickType_t NewPeriod, TickType_t CmdTimeout)
+        {
+            bool success = false;
+            if (FRT_IS_ISR())
+            {
+                BaseType_t taskWoken = pdFALSE;
+                success = xTimerChangePeriodFromISR(handle, NewPeriod, &taskWoken);
+
+                if (success)
+                    detail::yieldFromIsr(taskWoken);
+            }
+            else
+            {
+                success = xTimerChangePeriod(handle, NewPeriod, CmdTimeout);
+            }
+
+            return success;
+        }
+
+        // Pick the wakeup tick for the nominal expiry, within the slack window
+        TickType_t coalesce(bool &joined)
+        {
+            TickType_t best = 0;
+            bool found = false;
+
+            FRT_CRITICAL_ENTER();
+            for (Timer *other : coalescer().timers)
+            {
+                if (other == nullptr || other == this || !other->wakePending)
+                    continue;
+
+                const TickType_t offset = other->wake - nominal;
+                if (offset <= slack && (!found || offset < best - nominal))
+                {
+                    best = other->wake;
+                    found = true;
+                }
+            }
+
+            if (found)
+            {
+                wake = best;
+                coalescer().saved++;
+            }
+            else
+            {
+                const TickType_t grid = static_cast<TickType_t>(1) << (31 - __builtin_clz((static_cast<uint32_t>(slack) + 1U) | 1U));
+                wake = (nominal + grid - 1) & ~(grid - 1);
+            }
+
+            wakePending = true;
+            coalescer().expiries++;
+            joined = found;
+            FRT_CRITICAL_EXIT();
+
+            return wake;
+        }
+
+        // Withdraw a wakeup that could not be armed
+        void uncoalesce(bool joined)
+        {
+            FRT_CRITICAL_ENTER();
+            wakePending = false;
+            coalescer().expiries--;
+            if (joined)
+                coalescer().saved--;
+            FRT_CRITICAL_EXIT();
+        }
+
+        bool startCoalesced(TickType_t CmdTimeout)
+        {
+            const TickType_t now = FRT_IS_ISR() ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+
+            bool joined = false;
+
+            nominal = now + period;
+
+            // Also starts the timer, the changed period only applies to this expiry
+            if (changePeriod(coalesce(joined) - now, CmdTimeout))
+                return true;
+
+            uncoalesce(joined);
+            return false;
+        }
+
+        /**
+         *  Rearm a periodic timer with slack from its callback, one period
+         *  after the last nominal expiry. The daemon must not block on its
+         *  own command queue, so if the queue is full the timer keeps
+         *  auto-reloading with its last delay and is rearmed on the next expiry.
+         */
+        void rearmCoalesced()
+        {
+            const TickType_t now = xTaskGetTickCount();
+            bool joined = false;
+
+            nominal += period;
+            if (static_cast<int32_t>(nominal - now) <= 0)
+                nominal = now + period;
+
+            if (!changePeriod(coalesce(joined) - now, 0))
+                uncoalesce(joined);
+        }
+
+#ifdef FRT_TIMER_STATS
+        TimerStats timerStats;
+
+        struct DaemonStats
+        {
+            TimerStats stats;
+            TickType_t since;
+        };
+
+        static DaemonStats &daemon()
+        {
+            static DaemonStats instance = {};
+            return instance;
+        }
+
+        void initStats()
+        {
+            detail::enableCycleCounter();
+            timerStats.reset();
+        }
+#endif
 
         /**
          *  Adapter function that allows you to write a class
@@ -261,7 +608,33 @@ namespace frt
         static void TimerCallbackFunctionAdapter(TimerHandle_t xTimer)
         {
             Timer *timer = static_cast<Timer *>(pvTimerGetTimerID(xTimer));
+
+            if (timer->slack > 0)
+            {
+                timer->wakePending = false;
+
+                // Before the callback, so that it can still stop the timer
+                if (timer->autoReload)
+                    timer->rearmCoalesced();
+            }
+
+#ifdef FRT_TIMER_STATS
+            const TickType_t now = xTaskGetTickCount();
+            TickType_t scheduled = xTimerGetExpiryTime(xTimer);
+
+            // An auto-reload timer is already rearmed for its next period when the callback runs
+            if (uxTimerGetReloadMode(xTimer) != pdFALSE)
+                scheduled -= xTimerGetPeriod(xTimer);
+
+            const uint32_t start = detail::cycleCount();
             timer->run();
+            const uint32_t cycles = detail::cycleCount() - start;
+
+            timer->timerStats.record(now - scheduled, cycles);
+            daemon().stats.record(now - scheduled, cycles);
+#else
+            timer->run();
+#endif
         }
     };
 